@@ -21,6 +21,7 @@ import time
 from vts.runners.host import asserts
 from vts.runners.host import const
 from vts.runners.host import test_runner
+from vts.testcases.hal.automotive.vehicle.V2_0.host import vehicle_event_recorder
 from vts.testcases.template.hal_hidl_host_test import hal_hidl_host_test
 
 VEHICLE_V2_0_HAL = "android.hardware.automotive.vehicle@2.0::IVehicle"
@@ -30,10 +31,6 @@ class VtsHalAutomotiveVehicleV2_0HostTest(hal_hidl_host_test.HalHidlHostTest):
     """A simple testcase for the VEHICLE HIDL HAL.
 
     Attributes:
-        _arrived: boolean, the flag of onPropertyEvent received.
-        onPropertyEventCalled: integer, the number of onPropertyEvent received.
-        onPropertySetErrorCalled: integer, the number of onPropertySetError
-        received.
         DEVICE_TMP_DIR: string, target device's tmp directory path.
     """
 
@@ -70,6 +67,9 @@ class VtsHalAutomotiveVehicleV2_0HostTest(hal_hidl_host_test.HalHidlHostTest):
         for config in self.vehicle.getAllPropConfigs():
             self.propToConfig[config['prop']] = config
         self.configList = self.propToConfig.values()
+        # Values of static properties, keyed by (prop, areaId), read once and
+        # shared by all test cases.
+        self._staticValues = {}
 
     def tearDownClass(self):
         """Performs clean-up pushed file"""
@@ -163,6 +163,78 @@ class VtsHalAutomotiveVehicleV2_0HostTest(hal_hidl_host_test.HalHidlHostTest):
             expectedStatus = self.vtypes.StatusCode.OK
         asserts.assertEqual(expectedStatus, status, "Prop 0x%x" % propertyId)
 
+    def readVhalPropertiesCached(self, requests):
+        """Reads many properties from Vehicle HAL, skipping repeated reads.
+
+        Duplicate requests are read once and static properties are read once
+        per test class. Every other request is still one get call through
+        the VTS agent, and only a summary is logged instead of every request
+        and response.
+
+        Args:
+            requests: list of (propertyId, areaId) tuples.
+
+        Returns:
+            dict, maps (propertyId, areaId) to the value read from Vehicle
+            HAL, or None if it could not be read successfully.
+        """
+        values = {}
+        failed = []
+        for key in requests:
+            if key in values:
+                continue
+            if key in self._staticValues:
+                values[key] = self._staticValues[key]
+                continue
+            propertyId, areaId = key
+            vp = self.vtypes.Py2Pb("VehiclePropValue",
+                                   self.emptyValueProperty(propertyId, areaId))
+            status, value = self.vehicle.get(vp)
+            if self.vtypes.StatusCode.OK != status:
+                failed.append((propertyId, areaId, status))
+                value = None
+            values[key] = value
+            config = self.propToConfig.get(propertyId)
+            if (value is not None and config is not None and
+                    config["changeMode"] ==
+                    self.vtypes.VehiclePropertyChangeMode.STATIC):
+                self._staticValues[key] = value
+        logging.info("read of %d properties, %d failed: %s",
+                     len(values), len(failed),
+                     ["0x%x/0x%x: %d" % item for item in failed])
+        return values
+
+    def setVhalPropertiesAndCheckAll(self, requests):
+        """Sets many properties in Vehicle HAL and checks all statuses.
+
+        Each property is set with its own call. The statuses are checked only
+        after every set was issued, so that one run reports all properties
+        and areas that returned an unexpected status.
+
+        Args:
+            requests: list of (propertyId, value, areaId, expectedStatus)
+                      tuples, see setVhalProperty().
+        """
+        failures = []
+        for propertyId, value, areaId, expectedStatus in requests:
+            propValue = self.emptyValueProperty(propertyId, areaId)
+            for k in propValue["value"]:
+                if k in value:
+                    if k == "stringValue":
+                        propValue["value"][k] += value[k]
+                    else:
+                        propValue["value"][k].extend(value[k])
+            status = self.vehicle.set(
+                self.vtypes.Py2Pb("VehiclePropValue", propValue))
+            if 0 == expectedStatus:
+                expectedStatus = self.vtypes.StatusCode.OK
+            if expectedStatus != status:
+                failures.append("Prop 0x%x Area 0x%x: %d != %d" %
+                                (propertyId, areaId, status, expectedStatus))
+        logging.info("set of %d properties, %d failed", len(requests),
+                     len(failures))
+        asserts.assertEqual([], failures, "Unexpected set status")
+
     def setAndVerifyIntProperty(self, propertyId, value, areaId=0):
         """Sets a integer property in the Vehicle HAL and reads it back.
 
@@ -229,17 +301,18 @@ class VtsHalAutomotiveVehicleV2_0HostTest(hal_hidl_host_test.HalHidlHostTest):
             0, len(zones),
             "supportedAreas for HVAC_POWER_ON property is invalid")
 
-        # TODO(pavelm): consider to check for all zones
-        zone = zones[0]
-
-        propValue = self.readVhalProperty(
-            self.vtypes.VehicleProperty.HVAC_POWER_ON, areaId=zone)
-
-        asserts.assertEqual(1, len(propValue["value"]["int32Values"]))
-        asserts.assertTrue(
-            propValue["value"]["int32Values"][0] in [0, 1],
-            "%d not a valid value for HVAC_POWER_ON" %
-            propValue["value"]["int32Values"][0])
+        # Every phase below sweeps all zones before moving to the next one.
+        powerValues = self.readVhalPropertiesCached(
+            [(self.vtypes.VehicleProperty.HVAC_POWER_ON, zone)
+             for zone in zones])
+        for zone in zones:
+            propValue = powerValues[(self.vtypes.VehicleProperty.HVAC_POWER_ON,
+                                     zone)]
+            asserts.assertEqual(1, len(propValue["value"]["int32Values"]))
+            asserts.assertTrue(
+                propValue["value"]["int32Values"][0] in [0, 1],
+                "%d not a valid value for HVAC_POWER_ON" %
+                propValue["value"]["int32Values"][0])
 
         # Checks that HVAC_POWER_ON config string returns valid result.
         requestConfig = [
@@ -275,56 +348,54 @@ class VtsHalAutomotiveVehicleV2_0HostTest(hal_hidl_host_test.HalHidlHostTest):
                                "0x%X not an HVAC type" % prop)
 
         # Turn power on.
-        self.setAndVerifyIntProperty(
-            self.vtypes.VehicleProperty.HVAC_POWER_ON, 1, areaId=zone)
+        for zone in zones:
+            self.setAndVerifyIntProperty(
+                self.vtypes.VehicleProperty.HVAC_POWER_ON, 1, areaId=zone)
 
         # Check that properties that require power to be on can be set.
-        propVals = {}
-        for prop in configProps:
-            v = self.readVhalProperty(prop, areaId=zone)["value"]
-            self.setVhalProperty(prop, v, areaId=zone)
-            # Save the value for use later when trying to set the property when
-            # HVAC is off.
-            propVals[prop] = v
+        # Save the values for use later when trying to set the properties
+        # when HVAC is off.
+        propVals = self.readVhalPropertiesCached(
+            [(prop, zone) for zone in zones for prop in configProps])
+        self.setVhalPropertiesAndCheckAll(
+            [(prop, propVals[(prop, zone)]["value"], zone, 0)
+             for zone in zones for prop in configProps])
 
         # Turn power off.
-        self.setAndVerifyIntProperty(
-            self.vtypes.VehicleProperty.HVAC_POWER_ON, 0, areaId=zone)
+        for zone in zones:
+            self.setAndVerifyIntProperty(
+                self.vtypes.VehicleProperty.HVAC_POWER_ON, 0, areaId=zone)
 
         # Check that properties that require power to be on can't be set.
-        for prop in configProps:
-            self.setVhalProperty(
-                prop,
-                propVals[prop],
-                areaId=zone,
-                expectedStatus=self.vtypes.StatusCode.NOT_AVAILABLE)
+        self.setVhalPropertiesAndCheckAll(
+            [(prop, propVals[(prop, zone)]["value"], zone,
+              self.vtypes.StatusCode.NOT_AVAILABLE)
+             for zone in zones for prop in configProps])
 
         # Turn power on.
-        self.setAndVerifyIntProperty(
-            self.vtypes.VehicleProperty.HVAC_POWER_ON, 1, areaId=zone)
+        for zone in zones:
+            self.setAndVerifyIntProperty(
+                self.vtypes.VehicleProperty.HVAC_POWER_ON, 1, areaId=zone)
 
         # Check that properties that require power to be on can be set.
-        for prop in configProps:
-            self.setVhalProperty(prop, propVals[prop], areaId=zone)
+        self.setVhalPropertiesAndCheckAll(
+            [(prop, propVals[(prop, zone)]["value"], zone, 0)
+             for zone in zones for prop in configProps])
 
     def testSetBoolPropResponseTime(self):
-        """Verifies that a PropertyEvent arrives in a reasonable time on Boolean Properties"""
-
-        # PropertyEvent is received
-        self._arrived = False
-
-        def onPropertyEvent(vehiclePropValues):
-            for vp in vehiclePropValues:
-                if vp["prop"] & self.vtypes.VehiclePropertyType.BOOLEAN != 0:
-                    logging.info("onPropertyEvent received: %s",
-                                 vehiclePropValues)
-                    self._arrived = True
+        """Verifies that a PropertyEvent arrives in a reasonable time on Boolean Properties.
 
-        def onPropertySetError(errorCode, propId, areaId):
-            logging.info(
-                "onPropertySetError, error: %d, prop: 0x%x, area: 0x%x",
-                errorCode, propId, areaId)
-            self._arrived = True
+        The latency from set() to the arrival of the matching onPropertyEvent
+        is measured on the host. Each area is toggled vhal_latency_samples
+        times, and the p90 latency of every property must not exceed
+        vhal_latency_threshold_ms.
+        """
+        timeout = self.getUserParam("vhal_event_timeout_sec", default_value=5)
+        samples = self.getUserParam("vhal_latency_samples", default_value=1)
+        threshold_ms = self.getUserParam(
+            "vhal_latency_threshold_ms", default_value=timeout * 1000)
+        recorder = vehicle_event_recorder.PropertyEventRecorder()
+        latencies = vehicle_event_recorder.LatencyStats()
 
         for c in self.configList:
             if (c["access"] != self.vtypes.VehiclePropertyAccess.READ_WRITE or
@@ -333,14 +404,12 @@ class VtsHalAutomotiveVehicleV2_0HostTest(hal_hidl_host_test.HalHidlHostTest):
                 != self.vtypes.VehiclePropertyType.BOOLEAN):
                 continue
 
-            self._arrived = False
-
             # Register for on_change property
             prop = c["prop"]
             callback = self.vehicle.GetHidlCallbackInterface(
                 "IVehicleCallback",
-                onPropertyEvent=onPropertyEvent,
-                onPropertySetError=onPropertySetError
+                onPropertyEvent=recorder.onPropertyEvent,
+                onPropertySetError=recorder.onPropertySetError
             )
             subscribeOption = {
                 "propId": prop,
@@ -355,37 +424,186 @@ class VtsHalAutomotiveVehicleV2_0HostTest(hal_hidl_host_test.HalHidlHostTest):
 
             # Change value of properties
             for area in c["areaConfigs"]:
-                currPropVal = self.readVhalProperty(prop, area["areaId"])
-                updateVal = [0]
-                if (currPropVal["value"]["int32Values"] is None or
-                    currPropVal["value"]["int32Values"] == [0]):
-                    updateVal = [1]
-                propValue = self.emptyValueProperty(prop, area["areaId"])
-                for index in propValue["value"]:
-                    if index == "int32Values":
-                        propValue["value"][index].extend(updateVal)
-                vp = self.vtypes.Py2Pb("VehiclePropValue", propValue)
-                status = self.vehicle.set(vp)
-                if status != 0:
-                    logging.warning("Set value failed for Property 0x%x" % prop)
-                    continue
+                for _ in xrange(samples):
+                    currPropVal = self.readVhalProperty(prop, area["areaId"])
+                    updateVal = [0]
+                    if (currPropVal["value"]["int32Values"] is None or
+                        currPropVal["value"]["int32Values"] == [0]):
+                        updateVal = [1]
+                    propValue = self.emptyValueProperty(prop, area["areaId"])
+                    for index in propValue["value"]:
+                        if index == "int32Values":
+                            propValue["value"][index].extend(updateVal)
+                    vp = self.vtypes.Py2Pb("VehiclePropValue", propValue)
+                    mark = recorder.Mark()
+                    setTime = time.time()
+                    status = self.vehicle.set(vp)
+                    if status != 0:
+                        logging.warning("Set value failed for Property 0x%x" % prop)
+                        break
 
-                # Check callback is received in 5 second
-                waitingTime = 5
-                checkTimes = 5
-                for _ in xrange(checkTimes):
-                    if self._arrived:
-                        logging.info(
-                            "callback for Property: 0x%x is received" %
-                            prop)
+                    # Wait for the callback of this property and area.
+                    arrived = recorder.WaitForEvent(
+                        prop, area["areaId"], timeout=timeout, mark=mark)
+                    if arrived is None:
+                        asserts.fail(
+                            "callback is not received in %s seconds for "
+                            "Property: 0x%x" % (timeout, prop))
+                    arrival, event = arrived
+                    if event is None:
+                        # A set error ends the wait but is not a latency.
                         break
-                    time.sleep(waitingTime/checkTimes)
+                    latencies.Add(prop, (arrival - setTime) * 1000)
+                    logging.info(
+                        "callback for Property: 0x%x is received in %.2f ms",
+                        prop, (arrival - setTime) * 1000)
+            self.vehicle.unsubscribe(callback, prop)
+
+        latencies.Report("set_to_event", self.web)
+        regressions = latencies.Regressions(threshold_ms)
+        asserts.assertEqual(
+            [], regressions,
+            "p90 set-to-event latency (ms) exceeds %s: %s" % (threshold_ms, [
+                "0x%x: %.2f" % (prop, p90) for prop, p90 in regressions
+            ]))
+
+    def measureSampleRates(self, configs, rates, window):
+        """Subscribes to continuous properties and measures their delivery.
 
-                if not self._arrived:
-                    asserts.fail(
-                        "callback is not received in 5 seconds for Property: 0x%x"
-                        % prop)
-                self.vehicle.unsubscribe(callback, prop)
+        Args:
+            configs: list of VehiclePropConfig dicts, subscribed to at once.
+            rates: list of floats, sample rate in Hz of each property.
+            window: float, number of seconds to collect events for.
+
+        Returns:
+            dict, maps property id to the RateStats() dict of its events.
+        """
+        recorder = vehicle_event_recorder.PropertyEventRecorder()
+        callback = self.vehicle.GetHidlCallbackInterface(
+            "IVehicleCallback",
+            onPropertyEvent=recorder.onPropertyEvent,
+            onPropertySetError=recorder.onPropertySetError)
+        pbSubscribeOptions = [
+            self.vtypes.Py2Pb("SubscribeOptions", {
+                "propId": c["prop"],
+                "sampleRate": rate,
+                "flags": self.vtypes.SubscribeFlags.EVENTS_FROM_CAR,
+            }) for c, rate in zip(configs, rates)
+        ]
+        statusCode = self.vehicle.subscribe(callback, pbSubscribeOptions)
+        asserts.assertEqual(statusCode, 0, "Must successfully subscribe to "
+                            "properties %s" % [hex(c["prop"]) for c in configs])
+
+        # Skip the events delivered right after subscribing, which may carry
+        # the current values of all properties at once.
+        time.sleep(min(1.0, window / 2.0))
+        start = recorder.Mark()
+        # A fixed window is the measurement itself, not polling.
+        time.sleep(window)
+        end = recorder.Mark()
+        for c in configs:
+            self.vehicle.unsubscribe(callback, c["prop"])
+
+        return dict((c["prop"], vehicle_event_recorder.RateStats(
+            recorder.EventTimes(c["prop"], start, end), window))
+                    for c in configs)
+
+    def checkSampleRate(self, prop, rate, stats, tolerance):
+        """Returns a failure message if events were dropped or bursty.
+
+        Args:
+            prop: int, the property id.
+            rate: float, the subscribed sample rate in Hz.
+            stats: dict returned by RateStats().
+            tolerance: float, allowed relative deviation of the rate.
+
+        Returns:
+            string describing the failure, None if the delivery is fine.
+        """
+        logging.info(
+            "Property 0x%x at %.2f Hz: %d events, %.2f Hz, jitter %.2f, "
+            "max interval %.3f s", prop, rate, stats["count"], stats["rate"],
+            stats["jitter"], stats["max_interval"])
+        if stats["rate"] < rate * (1 - tolerance):
+            return "0x%x: %.2f Hz delivered at %.2f Hz (dropped)" % (
+                prop, stats["rate"], rate)
+        # An interval several periods long means the dispatch stalled and
+        # the events that follow arrive in a burst.
+        if stats["max_interval"] > 3.0 / rate + 0.1:
+            return "0x%x: %.3f s gap at %.2f Hz (bursty)" % (
+                prop, stats["max_interval"], rate)
+        if stats["rate"] > rate * (1 + tolerance):
+            logging.warning("Property 0x%x delivered above its rate: %s",
+                            prop, stats)
+        return None
+
+    def testContinuousPropSampleRates(self):
+        """Verifies the event rates of continuous properties.
+
+        Runs only if the vhal_sample_rate_window_sec user param is larger
+        than 0, since the windows can add minutes to the module. Every
+        continuous property is subscribed at its minSampleRate and
+        maxSampleRate, one property at a time. Then all of them are
+        subscribed at their maxSampleRate at once to expose dispatch
+        bottlenecks of the VHAL. The rate delivered over a window of
+        vhal_sample_rate_window_sec, extended to at least ten periods of the
+        slowest rate, must be within vhal_sample_rate_tolerance of the
+        subscribed rate, without gaps longer than three periods. Rates whose
+        ten periods exceed vhal_sample_rate_max_window_sec are skipped.
+        """
+        window = float(self.getUserParam("vhal_sample_rate_window_sec",
+                                         default_value=0))
+        asserts.skipIf(window <= 0, "Sample rate verification is disabled")
+        maxWindow = float(self.getUserParam("vhal_sample_rate_max_window_sec",
+                                            default_value=30))
+        tolerance = float(self.getUserParam("vhal_sample_rate_tolerance",
+                                            default_value=0.5))
+
+        def rateWindow(rate):
+            """Returns the window for a rate, None if it does not fit."""
+            periodsWindow = max(window, 10.0 / rate)
+            return periodsWindow if periodsWindow <= maxWindow else None
+
+        configs = [
+            c for c in self.configList
+            if c["changeMode"] == self.vtypes.VehiclePropertyChangeMode.
+            CONTINUOUS and c["access"] & self.vtypes.VehiclePropertyAccess.READ
+            and c["maxSampleRate"] > 0
+        ]
+        if not configs:
+            logging.info("No continuous property is supported")
+            return
+
+        failures = []
+        for c in configs:
+            for rate in sorted(set([c["minSampleRate"], c["maxSampleRate"]])):
+                if rate <= 0:
+                    continue
+                if not rateWindow(rate):
+                    logging.info("Skipping 0x%x at %.3f Hz, 10 periods "
+                                 "exceed %.1f s", c["prop"], rate, maxWindow)
+                    continue
+                stats = self.measureSampleRates([c], [rate],
+                                                rateWindow(rate))
+                failure = self.checkSampleRate(c["prop"], rate,
+                                               stats[c["prop"]], tolerance)
+                if failure:
+                    failures.append(failure)
+
+        configs = [c for c in configs if rateWindow(c["maxSampleRate"])]
+        if len(configs) > 1:
+            rates = [c["maxSampleRate"] for c in configs]
+            allStats = self.measureSampleRates(configs, rates,
+                                               rateWindow(min(rates)))
+            for c, rate in zip(configs, rates):
+                failure = self.checkSampleRate(c["prop"], rate,
+                                               allStats[c["prop"]], tolerance)
+                if failure:
+                    failures.append("all subscribed, " + failure)
+
+        asserts.assertEqual([], failures,
+                            "Continuous properties are not delivered at "
+                            "their sample rates: %s" % failures)
 
     def testVehicleStaticProps(self):
         """Verifies that static properties are configured correctly"""
@@ -404,6 +622,7 @@ class VtsHalAutomotiveVehicleV2_0HostTest(hal_hidl_host_test.HalHidlHostTest):
             self.vtypes.VehicleProperty.INFO_EV_PORT_LOCATION,
             self.vtypes.VehicleProperty.INFO_DRIVER_SEAT,
         ])
+        staticRequests = []
         for c in self.configList:
             prop = c['prop']
             msg = "Prop 0x%x" % prop
@@ -414,17 +633,24 @@ class VtsHalAutomotiveVehicleV2_0HostTest(hal_hidl_host_test.HalHidlHostTest):
                 asserts.assertEqual(self.vtypes.VehiclePropertyAccess.READ,
                                     c["access"], msg)
                 for area in c["areaConfigs"]:
-                    propValue = self.readVhalProperty(prop, area["areaId"])
-                    asserts.assertEqual(prop, propValue["prop"])
-                    self.setVhalProperty(
-                        prop,
-                        propValue["value"],
-                        expectedStatus=self.vtypes.StatusCode.ACCESS_DENIED)
+                    staticRequests.append((prop, area["areaId"]))
             else:  # Non-static property
                 asserts.assertNotEqual(
                     self.vtypes.VehiclePropertyChangeMode.STATIC,
                     c["changeMode"], msg)
 
+        # Read every static property and area, then check that none of them
+        # can be written.
+        propValues = self.readVhalPropertiesCached(staticRequests)
+        for prop, areaId in staticRequests:
+            propValue = propValues[(prop, areaId)]
+            asserts.assertNotEqual(None, propValue, "Prop 0x%x" % prop)
+            asserts.assertEqual(prop, propValue["prop"])
+        self.setVhalPropertiesAndCheckAll(
+            [(prop, propValues[(prop, areaId)]["value"], 0,
+              self.vtypes.StatusCode.ACCESS_DENIED)
+             for prop, areaId in staticRequests])
+
     def testPropertyRanges(self):
         """Retrieve the property ranges for all areas.
 
@@ -453,6 +679,18 @@ class VtsHalAutomotiveVehicleV2_0HostTest(hal_hidl_host_test.HalHidlHostTest):
             self.vtypes.VehicleProperty.INFO_DRIVER_SEAT,
         }
 
+        # Read every property and area that has a range first.
+        propValues = self.readVhalPropertiesCached([
+            (c["prop"], a["areaId"]) for c in self.configList
+            if c["prop"] & self.vtypes.VehiclePropertyType.BOOLEAN == 0
+            and c["access"] in (self.vtypes.VehiclePropertyAccess.READ_WRITE,
+                                self.vtypes.VehiclePropertyAccess.READ)
+            and c["prop"] not in enumProperties
+            and c["prop"] !=
+            self.vtypes.VehicleProperty.HVAC_TEMPERATURE_DISPLAY_UNITS
+            for a in c["areaConfigs"] or []
+        ])
+
         for c in self.configList:
             # Continuous properties need to have a sampling frequency.
             if c["changeMode"] == self.vtypes.VehiclePropertyChangeMode.CONTINUOUS:
@@ -503,7 +741,7 @@ class VtsHalAutomotiveVehicleV2_0HostTest(hal_hidl_host_test.HalHidlHostTest):
                          a[maxName]))
 
                 # Get a value and make sure it's within the bounds.
-                propVal = self.readVhalProperty(c["prop"], a["areaId"])
+                propVal = propValues[(c["prop"], a["areaId"])]
                 # Some values may not be available, which is not an error.
                 if propVal is None:
                     continue
@@ -683,18 +921,7 @@ class VtsHalAutomotiveVehicleV2_0HostTest(hal_hidl_host_test.HalHidlHostTest):
 
         This also tests an HIDL async callback.
         """
-        self.onPropertyEventCalled = 0
-        self.onPropertySetErrorCalled = 0
-
-        def onPropertyEvent(vehiclePropValues):
-            logging.info("onPropertyEvent received: %s", vehiclePropValues)
-            self.onPropertyEventCalled += 1
-
-        def onPropertySetError(erroCode, propId, areaId):
-            logging.info(
-                "onPropertySetError, error: %d, prop: 0x%x, area: 0x%x",
-                erroCode, prop, area)
-            self.onPropertySetErrorCalled += 1
+        recorder = vehicle_event_recorder.PropertyEventRecorder()
 
         config = self.getPropConfig(
             self.vtypes.VehicleProperty.ENGINE_OIL_TEMP)
@@ -716,8 +943,8 @@ class VtsHalAutomotiveVehicleV2_0HostTest(hal_hidl_host_test.HalHidlHostTest):
                 "ENGINE_OIL_TEMP is continuous property, subscribing...")
             callback = self.vehicle.GetHidlCallbackInterface(
                 "IVehicleCallback",
-                onPropertyEvent=onPropertyEvent,
-                onPropertySetError=onPropertySetError)
+                onPropertyEvent=recorder.onPropertyEvent,
+                onPropertySetError=recorder.onPropertySetError)
 
             subscribeOptions = {
                 "propId": self.vtypes.VehicleProperty.ENGINE_OIL_TEMP,
@@ -727,18 +954,19 @@ class VtsHalAutomotiveVehicleV2_0HostTest(hal_hidl_host_test.HalHidlHostTest):
             pbSubscribeOptions = self.vtypes.Py2Pb("SubscribeOptions",
                                                    subscribeOptions)
 
+            subscribeTime = time.time()
             statusCode = self.vehicle.subscribe(callback, [pbSubscribeOptions])
             if statusCode != 0:
                 asserts.fail("Can not register ENGINE_OIL_TEMP")
 
-            for _ in range(5):
-                if (self.onPropertyEventCalled > 0
-                        or self.onPropertySetErrorCalled > 0):
-                    self.vehicle.unsubscribe(
-                        callback, self.vtypes.VehicleProperty.ENGINE_OIL_TEMP)
-                    return
-                time.sleep(1)
-            asserts.fail("Callback not called in 5 seconds.")
+            arrived = recorder.WaitForEvent(
+                self.vtypes.VehicleProperty.ENGINE_OIL_TEMP, timeout=5)
+            self.vehicle.unsubscribe(
+                callback, self.vtypes.VehicleProperty.ENGINE_OIL_TEMP)
+            if arrived is None:
+                asserts.fail("Callback not called in 5 seconds.")
+            logging.info("First ENGINE_OIL_TEMP event received in %.2f ms",
+                         (arrived[0] - subscribeTime) * 1000)
 
     def getDiagnosticSupportInfo(self):
         """Check which of the OBD2 diagnostic properties are supported."""
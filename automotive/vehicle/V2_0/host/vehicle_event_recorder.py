@@ -0,0 +1,208 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2019 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Event-driven recording of IVehicleCallback events.
+
+PropertyEventRecorder is passed as the onPropertyEvent and
+onPropertySetError handlers of an IVehicleCallback. Every event is stamped
+with the host time at which it arrived and appended to a log guarded by a
+condition variable, so that a test can block until a matching event arrives
+instead of polling a flag, and can compute the latency from the host time at
+which the property was set.
+"""
+
+import logging
+import threading
+import time
+
+from vts.testcases.hal.script.utils.percentile import Percentile
+
+
+class PropertyEventRecorder(object):
+    """Records property events and set errors with their arrival time.
+
+    Attributes:
+        _condition: threading.Condition guarding the logs below.
+        _events: list of (arrival time, VehiclePropValue dict) tuples.
+        _errors: list of (arrival time, error code, prop, area id) tuples.
+    """
+
+    def __init__(self):
+        self._condition = threading.Condition()
+        self._events = []
+        self._errors = []
+
+    def onPropertyEvent(self, vehiclePropValues):
+        """IVehicleCallback.onPropertyEvent handler."""
+        arrival = time.time()
+        with self._condition:
+            for value in vehiclePropValues:
+                self._events.append((arrival, value))
+            self._condition.notifyAll()
+
+    def onPropertySetError(self, errorCode, propId, areaId):
+        """IVehicleCallback.onPropertySetError handler."""
+        arrival = time.time()
+        logging.info("onPropertySetError, error: %d, prop: 0x%x, area: 0x%x",
+                     errorCode, propId, areaId)
+        with self._condition:
+            self._errors.append((arrival, errorCode, propId, areaId))
+            self._condition.notifyAll()
+
+    def Mark(self):
+        """Returns a position so that later waits only see newer events."""
+        with self._condition:
+            return (len(self._events), len(self._errors))
+
+    def EventCount(self, mark=(0, 0)):
+        """Returns the number of events recorded after a mark."""
+        with self._condition:
+            return len(self._events) - mark[0]
+
+    def EventTimes(self, propId, start=(0, 0), end=None):
+        """Returns the times of the events of a property between two marks.
+
+        The device timestamp of an event is used when every event has one,
+        because it is not skewed by binder and host dispatch. Otherwise the
+        host arrival times are returned.
+
+        Args:
+            propId: int, the property id.
+            start: tuple returned by Mark() before the events.
+            end: tuple returned by Mark() after the events, None for now.
+
+        Returns:
+            list of floats, times in seconds in arrival order.
+        """
+        with self._condition:
+            events = self._events[start[0]:end[0] if end else None]
+        events = [(arrival, value) for arrival, value in events
+                  if value["prop"] == propId]
+        if events and all(value.get("timestamp") for _, value in events):
+            return [value["timestamp"] / 1e9 for _, value in events]
+        return [arrival for arrival, _ in events]
+
+    def WaitForEvent(self, propId, areaId=None, timeout=5, mark=(0, 0)):
+        """Blocks until an event of a property arrives after a mark.
+
+        A set error of the property also ends the wait.
+
+        Args:
+            propId: int, the property id.
+            areaId: int, the area id, None to match any area.
+            timeout: float, maximum number of seconds to wait.
+            mark: tuple returned by Mark() before the triggering call.
+
+        Returns:
+            (arrival time, VehiclePropValue dict) of the first matching
+            event, (arrival time, None) if a set error arrived first, or
+            None on timeout.
+        """
+        deadline = time.time() + timeout
+        with self._condition:
+            while True:
+                for arrival, value in self._events[mark[0]:]:
+                    if value["prop"] == propId and (
+                            areaId is None or value["areaId"] == areaId):
+                        return (arrival, value)
+                for arrival, _, errorPropId, errorAreaId in \
+                        self._errors[mark[1]:]:
+                    if errorPropId == propId and (
+                            areaId is None or errorAreaId == areaId):
+                        return (arrival, None)
+                remaining = deadline - time.time()
+                if remaining <= 0:
+                    return None
+                self._condition.wait(remaining)
+
+
+def RateStats(times, window):
+    """Computes the delivery rate and regularity of a stream of events.
+
+    Args:
+        times: list of floats, event times in seconds.
+        window: float, length of the measurement window in seconds.
+
+    Returns:
+        dict with the event count, the rate in Hz over the window, the mean
+        and maximum interval in seconds, and the jitter, i.e. the standard
+        deviation of the intervals relative to their mean.
+    """
+    intervals = [b - a for a, b in zip(times, times[1:])]
+    stats = {
+        "count": len(times),
+        "rate": len(times) / float(window),
+        "mean_interval": 0,
+        "max_interval": 0,
+        "jitter": 0,
+    }
+    if intervals:
+        mean = sum(intervals) / len(intervals)
+        stats["mean_interval"] = mean
+        stats["max_interval"] = max(intervals)
+        if mean > 0:
+            variance = sum((i - mean)**2 for i in intervals) / len(intervals)
+            stats["jitter"] = variance**0.5 / mean
+    return stats
+
+
+class LatencyStats(object):
+    """Per-property latency samples checked against a regression threshold.
+
+    Attributes:
+        _samples: dict, maps property id to a list of latencies in ms.
+    """
+
+    def __init__(self):
+        self._samples = {}
+
+    def Add(self, propId, latency_ms):
+        """Adds a latency sample of a property."""
+        self._samples.setdefault(propId, []).append(latency_ms)
+
+    def Summary(self):
+        """Returns a list of (prop, count, p50, p90, max) sorted by prop."""
+        return [(propId, len(samples), Percentile(samples, 50),
+                 Percentile(samples, 90), max(samples))
+                for propId, samples in sorted(self._samples.iteritems())]
+
+    def Report(self, name, web=None):
+        """Logs the latency distributions and uploads them.
+
+        Args:
+            name: string, name of the measurement, e.g. 'set_to_event'.
+            web: web_utils.WebFeature of the test, None to only log.
+        """
+        summary = self.Summary()
+        if not summary:
+            return
+        logging.info("%s latency (ms): %-12s %6s %10s %10s %10s", name,
+                     "prop", "count", "p50", "p90", "max")
+        for propId, count, p50, p90, maximum in summary:
+            logging.info("%s latency (ms): 0x%-10x %6d %10.2f %10.2f %10.2f",
+                         name, propId, count, p50, p90, maximum)
+        if web and web.enabled:
+            web.AddProfilingDataLabeledVector(
+                "vhal_%s_latency_p90" % name,
+                ["0x%x" % item[0] for item in summary],
+                [int(item[3]) for item in summary],
+                x_axis_label="property",
+                y_axis_label="latency (ms)")
+
+    def Regressions(self, threshold_ms):
+        """Returns the properties whose p90 latency exceeds the threshold."""
+        return [(propId, p90) for propId, _, _, p90, _ in self.Summary()
+                if p90 > threshold_ms]
@@ -0,0 +1,254 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2019 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Snapshot of the device capabilities that host tests probe at setup.
+
+The system properties, the feature list of the package manager, the shell
+environment, the VINTF manifest of the vendor partition and the HAL instances
+served with their bitness are read in one batched shell call. The snapshot is
+kept in memory and in a file on the host, so that the following test modules
+of a plan on the same device read it from there. The instance names that
+hal_service_name_utils selects for a HAL are added to the snapshot on first
+use.
+
+A cached snapshot is used as long as the device has not rebooted, which costs
+one short shell call. The snapshot is meant for values that are fixed after
+boot, e.g. ro.* properties and features. Tests that change the device state
+should keep querying it directly.
+"""
+
+import json
+import logging
+import os
+import re
+import tempfile
+import time
+
+from vts.runners.host import const
+from vts.testcases.hal.script.utils.const import Constant
+from vts.utils.python.hal import hal_service_name_utils
+
+# Commands whose outputs make up the snapshot, in the order they run.
+BOOT_ID_COMMAND = Constant.BOOT_ID_COMMAND
+SNAPSHOT_COMMANDS = [
+    BOOT_ID_COMMAND,
+    'getprop',
+    'pm list features',
+    'printenv',
+    'cat /vendor/etc/vintf/manifest.xml /vendor/etc/vintf/manifest/*.xml '
+    '2>/dev/null',
+    'lshal --neat -itr',
+    # Features declared by the permission files, read by the package manager
+    # at boot. Used if the framework is stopped and pm does not respond.
+    'cat /system/etc/permissions/*.xml /vendor/etc/permissions/*.xml '
+    '/odm/etc/permissions/*.xml /product/etc/permissions/*.xml 2>/dev/null | '
+    'grep -o \'<feature name="[^"]*"\'',
+]
+CACHE_FILE = os.path.join(tempfile.gettempdir(),
+                          Constant.DEVICE_SNAPSHOT_CACHE_FILE)
+
+PROPERTY_RE = re.compile(r'^\[(.*?)\]: \[(.*)\]$')
+FEATURE_PREFIX = 'feature:'
+FEATURE_XML_RE = re.compile(r'<feature name="([^"]*)"')
+
+# Snapshots read by this process, by device serial.
+_snapshots = {}
+
+
+class DeviceSnapshot(object):
+    """Capabilities of a device.
+
+    Attributes:
+        boot_id: string, boot id of the device when the snapshot was taken.
+        properties: dict, system properties by name.
+        features: set of strings, names of the features of the package
+                  manager. Read from the permission files if the framework
+                  was not running.
+        environment: dict, environment variables of the shell.
+        vintf_manifest: string, content of the vendor VINTF manifest files.
+        hal_instances: list of (fq instance name, transport, arch) tuples
+                       reported by lshal, e.g.
+                       ('android.hardware.foo@1.0::IFoo/default', 'hwbinder',
+                       '64').
+        hal_service_names: dict, maps 'hal|bitness' keys to the (testable,
+                           instance names) results of
+                           hal_service_name_utils.GetHalServiceName().
+    """
+
+    def __init__(self, boot_id, properties, features, environment,
+                 vintf_manifest, hal_instances, hal_service_names=None):
+        self.boot_id = boot_id
+        self.properties = properties
+        self.features = features
+        self.environment = environment
+        self.vintf_manifest = vintf_manifest
+        self.hal_instances = hal_instances
+        self.hal_service_names = hal_service_names or {}
+
+    @classmethod
+    def FromOutputs(cls, outputs):
+        """Parses the stdouts of SNAPSHOT_COMMANDS.
+
+        Args:
+            outputs: list of strings, one per command.
+
+        Returns:
+            DeviceSnapshot object.
+        """
+        (boot_id, getprop, features, printenv, manifest, lshal,
+         feature_xml) = outputs
+        properties = {}
+        for line in getprop.splitlines():
+            match = PROPERTY_RE.match(line.strip())
+            if match:
+                properties[match.group(1)] = match.group(2)
+        feature_set = set()
+        for line in features.splitlines():
+            line = line.strip()
+            if line.startswith(FEATURE_PREFIX):
+                feature_set.add(line[len(FEATURE_PREFIX):].split('=')[0])
+        if not feature_set:
+            feature_set.update(FEATURE_XML_RE.findall(feature_xml))
+        environment = {}
+        for line in printenv.splitlines():
+            if '=' in line:
+                name, value = line.split('=', 1)
+                environment[name] = value
+        hal_instances = []
+        for line in lshal.splitlines():
+            fields = line.split()
+            if len(fields) == 3 and '::' in fields[0]:
+                hal_instances.append(tuple(fields))
+        return cls(boot_id.strip(), properties, feature_set, environment,
+                   manifest, hal_instances)
+
+    def ToDict(self):
+        """Returns the snapshot as a JSON serializable dict."""
+        return {
+            'boot_id': self.boot_id,
+            'properties': self.properties,
+            'features': sorted(self.features),
+            'environment': self.environment,
+            'vintf_manifest': self.vintf_manifest,
+            'hal_instances': self.hal_instances,
+            'hal_service_names': self.hal_service_names,
+        }
+
+    @classmethod
+    def FromDict(cls, content):
+        """Creates a snapshot from the output of ToDict()."""
+        return cls(content['boot_id'], content['properties'],
+                   set(content['features']), content['environment'],
+                   content['vintf_manifest'],
+                   [tuple(instance) for instance in content['hal_instances']],
+                   content.get('hal_service_names'))
+
+    def GetProperty(self, name, default=None):
+        """Returns the value of a system property, default if undefined."""
+        value = self.properties.get(name)
+        return value if value else default
+
+    def GetEnv(self, name):
+        """Returns the value of an environment variable, None if undefined."""
+        return self.environment.get(name) or None
+
+    def HasFeature(self, name):
+        """Returns whether the package manager lists a feature."""
+        return name in self.features
+
+
+def _ReadCache(serial):
+    """Returns the snapshot cached in the host file, None if absent."""
+    try:
+        with open(CACHE_FILE % serial) as cache_file:
+            return DeviceSnapshot.FromDict(json.load(cache_file))
+    except (IOError, ValueError, KeyError, TypeError):
+        return None
+
+
+def _WriteCache(serial, snapshot):
+    """Writes a snapshot to the host file, replacing it atomically."""
+    path = CACHE_FILE % serial
+    temp_path = '%s.%d' % (path, os.getpid())
+    try:
+        with open(temp_path, 'w') as cache_file:
+            json.dump(snapshot.ToDict(), cache_file)
+        os.rename(temp_path, path)
+    except (IOError, OSError) as e:
+        logging.warning('Failed to cache device snapshot: %s', e)
+
+
+def GetSnapshot(dut, refresh=False):
+    """Returns the capability snapshot of a device, taking it if needed.
+
+    Args:
+        dut: AndroidDevice controller of the device.
+        refresh: bool, whether to take a new snapshot even if one is cached.
+
+    Returns:
+        DeviceSnapshot object.
+    """
+    serial = dut.serial
+    if not refresh:
+        if serial in _snapshots:
+            return _snapshots[serial]
+        snapshot = _ReadCache(serial)
+        if snapshot:
+            results = dut.shell.Execute(BOOT_ID_COMMAND)
+            if results[const.STDOUT][0].strip() == snapshot.boot_id:
+                _snapshots[serial] = snapshot
+                return snapshot
+            logging.info('Device %s rebooted, taking a new snapshot', serial)
+
+    start_time = time.time()
+    results = dut.shell.Execute(SNAPSHOT_COMMANDS)
+    snapshot = DeviceSnapshot.FromOutputs(results[const.STDOUT])
+    logging.info('Took snapshot of device %s in %.1f s: %d properties, '
+                 '%d features, %d HAL instances', serial,
+                 time.time() - start_time, len(snapshot.properties),
+                 len(snapshot.features), len(snapshot.hal_instances))
+    _snapshots[serial] = snapshot
+    _WriteCache(serial, snapshot)
+    return snapshot
+
+
+def GetHalServiceName(dut, shell, hal, bitness='64'):
+    """Returns the instance names of a HAL to test, cached in the snapshot.
+
+    The result of hal_service_name_utils.GetHalServiceName() is kept per HAL
+    and bitness, so that the following modules of a plan skip its lshal and
+    VINTF queries.
+
+    Args:
+        dut: AndroidDevice controller of the device.
+        shell: shell of the device, passed to hal_service_name_utils.
+        hal: string, fq name of the HAL interface, e.g.
+             'android.hardware.foo@1.0::IFoo'.
+        bitness: string, '32' or '64'.
+
+    Returns:
+        a pair of whether the HAL is testable, and the set of its instance
+        names.
+    """
+    snapshot = GetSnapshot(dut)
+    key = '%s|%s' % (hal, bitness)
+    if key not in snapshot.hal_service_names:
+        testable, names = hal_service_name_utils.GetHalServiceName(
+            shell, hal, bitness)
+        snapshot.hal_service_names[key] = [testable, sorted(names)]
+        _WriteCache(dut.serial, snapshot)
+    testable, names = snapshot.hal_service_names[key]
+    return testable, set(names)
@@ -0,0 +1,67 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2019 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Stops and starts the Android framework around host tests.
+
+With --framework_stop_window, script/plan_scheduler.py runs all modules of
+the framework-stopped scheduling group of a plan inside one window: it stops
+the framework once, sets WINDOW_PROPERTY on the device, runs the modules and
+starts the framework again at the end. Host tests that stop the framework themselves use
+StopFramework() and StartFramework(), which leave the framework alone while
+such a window is open, so that each module does not pay for a restart.
+"""
+
+import logging
+
+from vts.runners.host import const
+from vts.testcases.hal.script.utils.const import Constant
+
+# Set to 1 by plan_scheduler.py while a framework stop window is open.
+WINDOW_PROPERTY = Constant.FRAMEWORK_STOP_WINDOW_PROPERTY
+
+
+def InWindow(dut):
+    """Returns whether a framework stop window is open on a device."""
+    results = dut.shell.Execute('getprop %s' % WINDOW_PROPERTY)
+    return results[const.STDOUT][0].strip() == '1'
+
+
+def StopFramework(dut):
+    """Stops the framework unless a window already stopped it.
+
+    Args:
+        dut: AndroidDevice controller of the device.
+
+    Returns:
+        True if the framework was stopped by this call, in which case
+        StartFramework() must be called to start it again.
+    """
+    if InWindow(dut):
+        logging.info('Framework stop window is open, not stopping framework')
+        return False
+    dut.stop(True)
+    return True
+
+
+def StartFramework(dut, stopped=True):
+    """Starts the framework if StopFramework() stopped it.
+
+    Args:
+        dut: AndroidDevice controller of the device.
+        stopped: bool, the return value of StopFramework().
+    """
+    if stopped:
+        dut.start()
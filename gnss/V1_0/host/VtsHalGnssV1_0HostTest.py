@@ -16,16 +16,20 @@
 #
 
 import logging
+import time
 
 from vts.runners.host import asserts
 from vts.runners.host import keys
 from vts.runners.host import test_runner
+from vts.testcases.hal.gnss.V1_0.host import gnss_benchmark
 from vts.testcases.template.hal_hidl_host_test import hal_hidl_host_test
 
 class VtsHalGnssV1_0HostTest(hal_hidl_host_test.HalHidlHostTest):
     """A simple testcase for the GNSS HIDL HAL."""
 
     SYSPROP_GETSTUB = "vts.hal.vts.hidl.get_stub"
+    # IGnss::GnssAidingData::DELETE_ALL
+    DELETE_ALL_AIDING_DATA = 0xffff
     TEST_HAL_SERVICES = {"android.hardware.gnss@1.0::IGnss"}
     def setUpClass(self):
         """Creates a mirror and turns on the framework-layer GNSS service."""
@@ -148,5 +152,73 @@ class VtsHalGnssV1_0HostTest(hal_hidl_host_test.HalHidlHostTest):
         if not nested_interface:
             logging.error("ExtensionGnssDebug not implemented")
 
+    def testLocationFixBenchmark(self):
+        """Measures time to first fix and the pacing of the callbacks.
+
+        Runs only if the gnss_benchmark_window_sec user param is larger than
+        0. A periodic session with gnss_fix_interval_ms is started, optionally
+        after deleting all aiding data (gnss_cold_start), and the callbacks
+        are recorded for the window after the first fix. With gnss_simulated,
+        a simulated receiver stands in for the HAL.
+        """
+        window = float(self.getUserParam("gnss_benchmark_window_sec",
+                                         default_value=0))
+        asserts.skipIf(window <= 0, "GNSS benchmark is disabled")
+        interval_ms = int(self.getUserParam("gnss_fix_interval_ms",
+                                            default_value=1000))
+        ttff_timeout = float(self.getUserParam("gnss_ttff_timeout_sec",
+                                               default_value=180))
+
+        recorder = gnss_benchmark.GnssCallbackRecorder()
+        if self.getUserParam("gnss_simulated", default_value=False):
+            gnss = gnss_benchmark.SimulatedGnss()
+            gnss.setCallback(recorder)
+        else:
+            gnss = self.dut.hal.gnss
+            gnss.setCallback(
+                gnss.GetHidlCallbackInterface("IGnssCallback",
+                                              **recorder.Handlers()))
+        if self.getUserParam("gnss_cold_start", default_value=False):
+            gnss.deleteAidingData(self.DELETE_ALL_AIDING_DATA)
+
+        # MS_BASED mode, PERIODIC recurrence.
+        asserts.assertTrue(gnss.setPositionMode(1, 0, interval_ms, 0, 0),
+                           "setPositionMode failed")
+        recorder.Start()
+        asserts.assertTrue(gnss.start(), "start failed")
+        try:
+            ttff = recorder.WaitForFirstFix(ttff_timeout)
+            asserts.assertTrue(
+                ttff is not None,
+                "No fix within %s seconds" % ttff_timeout)
+            # A fixed window is the measurement itself, not polling.
+            time.sleep(window)
+        finally:
+            gnss.stop()
+
+        stats = recorder.Stats(interval_ms / 1000.0)
+        logging.info("GNSS time to first fix: %.2f s, callbacks: %s", ttff,
+                     stats)
+        if self.web.enabled:
+            self.web.AddProfilingDataTimestamp("gnss_ttff", 0,
+                                               int(ttff * 1000))
+            self.web.AddProfilingDataLabeledVector(
+                "gnss_callback_pacing",
+                ["fixes", "mean_interval_pct", "max_interval_pct",
+                 "nmea_burst_max", "sv_status_burst_max"],
+                [stats["fixes"],
+                 int(stats.get("mean_interval_ratio", 0) * 100),
+                 int(stats.get("max_interval_ratio", 0) * 100),
+                 stats["nmea_burst_max"], stats["sv_status_burst_max"]],
+                x_axis_label="metric",
+                y_axis_label="value")
+        asserts.assertLess(1, stats["fixes"],
+                           "Less than two fixes in %s seconds" % window)
+        # A fix may come late, but not more than one interval late.
+        asserts.assertLess(
+            stats["max_interval_ratio"], 2.0,
+            "Location callbacks are %.1fx the requested interval" %
+            stats["max_interval_ratio"])
+
 if __name__ == "__main__":
     test_runner.main()
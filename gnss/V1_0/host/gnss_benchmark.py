@@ -0,0 +1,224 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2019 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Callback timing of the GNSS HAL.
+
+GnssCallbackRecorder provides the IGnssCallback handlers. It records the host
+time of every callback, so that the time to first fix, the location callback
+rate and the sizes of the NMEA and SvStatus bursts reported with every fix
+can be computed.
+
+SimulatedGnss is a stand-in for the IGnss mirror. It produces callbacks on
+its own thread with the pacing of a receiver, so that the measurement can be
+run and checked without a sky view.
+"""
+
+import logging
+import threading
+import time
+
+# Callbacks closer to each other than this belong to the same burst.
+BURST_GAP_SEC = 0.1
+# NMEA sentences reported with every fix by SimulatedGnss.
+SIMULATED_NMEA = ("GPGGA", "GPGSA", "GPGSV", "GPGSV", "GPRMC", "GPVTG")
+
+
+class GnssCallbackRecorder(object):
+    """Records the arrival time of IGnssCallback callbacks.
+
+    Attributes:
+        _condition: threading.Condition guarding the logs below.
+        _locations: list of (arrival time, GnssLocation dict) tuples.
+        _nmea: list of arrival times of gnssNmeaCb.
+        _sv_status: list of arrival times of gnssSvStatusCb.
+        _start: float, host time at which the session was started.
+    """
+
+    def __init__(self):
+        self._condition = threading.Condition()
+        self._locations = []
+        self._nmea = []
+        self._sv_status = []
+        self._start = None
+
+    def Start(self):
+        """Clears the logs and marks the start of a session."""
+        with self._condition:
+            self._locations = []
+            self._nmea = []
+            self._sv_status = []
+            self._start = time.time()
+
+    def gnssLocationCb(self, location):
+        """IGnssCallback.gnssLocationCb handler."""
+        with self._condition:
+            self._locations.append((time.time(), location))
+            self._condition.notifyAll()
+
+    def gnssStatusCb(self, status):
+        logging.info("callback gnssStatusCb")
+
+    def gnssSvStatusCb(self, svInfo):
+        """IGnssCallback.gnssSvStatusCb handler."""
+        with self._condition:
+            self._sv_status.append(time.time())
+
+    def gnssNmeaCb(self, timestamp, nmea):
+        """IGnssCallback.gnssNmeaCb handler."""
+        with self._condition:
+            self._nmea.append(time.time())
+
+    def gnssSetCapabilitesCb(self, capabilities):
+        logging.info("callback gnssSetCapabilitesCb")
+
+    def gnssAcquireWakelockCb(self):
+        logging.info("callback gnssAcquireWakelockCb")
+
+    def gnssReleaseWakelockCb(self):
+        logging.info("callback gnssReleaseWakelockCb")
+
+    def gnssRequestTimeCb(self):
+        logging.info("callback gnssRequestTimeCb")
+
+    def gnssSetSystemInfoCb(self, info):
+        logging.info("callback gnssSetSystemInfoCb")
+
+    def Handlers(self):
+        """Returns the handlers as keyword arguments of a callback mirror."""
+        names = ("gnssLocationCb", "gnssStatusCb", "gnssSvStatusCb",
+                 "gnssNmeaCb", "gnssSetCapabilitesCb", "gnssAcquireWakelockCb",
+                 "gnssReleaseWakelockCb", "gnssRequestTimeCb",
+                 "gnssSetSystemInfoCb")
+        return dict((name, getattr(self, name)) for name in names)
+
+    def WaitForFirstFix(self, timeout):
+        """Blocks until the first location arrives.
+
+        Args:
+            timeout: float, maximum number of seconds to wait.
+
+        Returns:
+            float, time to first fix in seconds, None on timeout.
+        """
+        deadline = time.time() + timeout
+        with self._condition:
+            while not self._locations:
+                remaining = deadline - time.time()
+                if remaining <= 0:
+                    return None
+                self._condition.wait(remaining)
+            return self._locations[0][0] - self._start
+
+    @staticmethod
+    def _BurstSizes(times):
+        """Groups arrival times into bursts and returns their sizes."""
+        sizes = []
+        previous = None
+        for arrival in times:
+            if previous is None or arrival - previous > BURST_GAP_SEC:
+                sizes.append(0)
+            sizes[-1] += 1
+            previous = arrival
+        return sizes
+
+    def Stats(self, interval_sec):
+        """Computes the pacing of the callbacks after the first fix.
+
+        Args:
+            interval_sec: float, the requested interval between fixes.
+
+        Returns:
+            dict with the number of fixes, their mean and maximum interval
+            relative to interval_sec, and the mean and maximum sizes of the
+            NMEA and SvStatus bursts.
+        """
+        with self._condition:
+            fixes = [arrival for arrival, _ in self._locations]
+            nmea = list(self._nmea)
+            sv_status = list(self._sv_status)
+        intervals = [b - a for a, b in zip(fixes, fixes[1:])]
+        stats = {"fixes": len(fixes)}
+        if intervals:
+            mean = sum(intervals) / len(intervals)
+            stats["mean_interval_ratio"] = mean / interval_sec
+            stats["max_interval_ratio"] = max(intervals) / interval_sec
+            stats["rate_hz"] = 1.0 / mean if mean > 0 else 0
+        for name, times in (("nmea", nmea), ("sv_status", sv_status)):
+            sizes = self._BurstSizes(times)
+            stats[name + "_bursts"] = len(sizes)
+            stats[name + "_burst_mean"] = (float(sum(sizes)) / len(sizes)
+                                           if sizes else 0)
+            stats[name + "_burst_max"] = max(sizes) if sizes else 0
+        return stats
+
+
+class SimulatedGnss(object):
+    """Stand-in for the IGnss mirror used by the GNSS benchmark.
+
+    After start(), the first fix is reported after ttff_sec. Then every
+    minIntervalMs a burst of NMEA sentences, one SvStatus and one location
+    are reported.
+
+    Attributes:
+        _ttff_sec: float, simulated time to first fix.
+        _callback: object with the IGnssCallback handlers.
+        _interval_sec: float, interval between fixes.
+        _stop: threading.Event, set to stop the session.
+        _thread: threading.Thread producing the callbacks.
+    """
+
+    def __init__(self, ttff_sec=1.0):
+        self._ttff_sec = ttff_sec
+        self._callback = None
+        self._interval_sec = 1.0
+        self._stop = threading.Event()
+        self._thread = None
+
+    def setCallback(self, callback):
+        self._callback = callback
+        return True
+
+    def setPositionMode(self, mode, recurrence, minIntervalMs,
+                        preferredAccuracyMeters, preferredTimeMs):
+        self._interval_sec = max(minIntervalMs, 1) / 1000.0
+        return True
+
+    def deleteAidingData(self, aidingDataFlags):
+        pass
+
+    def start(self):
+        self._stop.clear()
+        self._thread = threading.Thread(target=self._Run)
+        self._thread.daemon = True
+        self._thread.start()
+        return True
+
+    def stop(self):
+        self._stop.set()
+        if self._thread:
+            self._thread.join()
+        return True
+
+    def _Run(self):
+        """Produces a burst of callbacks for every fix until stopped."""
+        next_fix = time.time() + self._ttff_sec
+        while not self._stop.wait(max(next_fix - time.time(), 0)):
+            timestamp = int(time.time() * 1000)
+            for sentence in SIMULATED_NMEA:
+                self._callback.gnssNmeaCb(timestamp, "$%s" % sentence)
+            self._callback.gnssSvStatusCb({"numSvs": 8})
+            self._callback.gnssLocationCb({"timestamp": timestamp})
+            next_fix += self._interval_sec
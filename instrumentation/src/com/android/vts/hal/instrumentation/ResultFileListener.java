@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.vts.hal.instrumentation;
+
+import android.util.Log;
+import androidx.test.InstrumentationRegistry;
+import java.io.File;
+import java.io.FileWriter;
+import java.io.IOException;
+import org.json.JSONArray;
+import org.json.JSONException;
+import org.json.JSONObject;
+import org.junit.runner.Description;
+import org.junit.runner.Result;
+import org.junit.runner.notification.Failure;
+import org.junit.runner.notification.RunListener;
+
+/**
+ * Writes the verdict and metrics of every test to one JSON result file.
+ *
+ * Registered with {@code am instrument -e listener}. The file is written to the path of the
+ * {@code resultFile} instrumentation argument, or to {@code instrumentation_result.json} in
+ * the external files directory of the app, when the run finishes:
+ * <pre>
+ * {"tests": [{"name": "Class#method", "status": "passed|failed|skipped",
+ *             "message": "...", "metrics": {"key": 1.0}}]}
+ * </pre>
+ * A test that covers several HAL instances at once reports one sub-result per instance,
+ * named {@code Class#method@instance}.
+ */
+public class ResultFileListener extends RunListener {
+    private static final String TAG = "ResultFileListener";
+    private static final String ARG_RESULT_FILE = "resultFile";
+    private static final String DEFAULT_RESULT_FILE = "instrumentation_result.json";
+    private static final int MAX_MESSAGE_LENGTH = 1024;
+
+    private static JSONObject sCurrentTest;
+    private static final JSONArray sTests = new JSONArray();
+
+    /** Attaches a metric to the running test. */
+    public static synchronized void addMetric(String key, double value) {
+        if (sCurrentTest == null) {
+            return;
+        }
+        try {
+            sCurrentTest.getJSONObject("metrics").put(key, value);
+        } catch (JSONException e) {
+            Log.e(TAG, "Failed to add metric " + key, e);
+        }
+    }
+
+    /** Records the verdict of the running test for one of the HAL instances it covers. */
+    public static synchronized void addSubResult(String instance, String status, String message) {
+        if (sCurrentTest == null) {
+            return;
+        }
+        try {
+            JSONObject subResult = new JSONObject();
+            subResult.put("name", sCurrentTest.getString("name") + "@" + instance);
+            subResult.put("status", status);
+            subResult.put("message", message == null ? "" : message);
+            subResult.put("metrics", new JSONObject());
+            sTests.put(subResult);
+        } catch (JSONException e) {
+            Log.e(TAG, "Failed to add sub-result for " + instance, e);
+        }
+    }
+
+    private static synchronized void setCurrentTest(JSONObject test) {
+        sCurrentTest = test;
+    }
+
+    private static synchronized void setStatus(String status, String message)
+            throws JSONException {
+        if (sCurrentTest == null) {
+            return;
+        }
+        sCurrentTest.put("status", status);
+        if (message != null) {
+            sCurrentTest.put("message", message.length() > MAX_MESSAGE_LENGTH
+                            ? message.substring(0, MAX_MESSAGE_LENGTH)
+                            : message);
+        }
+    }
+
+    @Override
+    public void testStarted(Description description) throws JSONException {
+        JSONObject test = new JSONObject();
+        test.put("name", description.getClassName() + "#" + description.getMethodName());
+        test.put("status", "passed");
+        test.put("metrics", new JSONObject());
+        addTest(test);
+        setCurrentTest(test);
+    }
+
+    private static synchronized void addTest(JSONObject test) {
+        sTests.put(test);
+    }
+
+    @Override
+    public void testFailure(Failure failure) throws JSONException {
+        setStatus("failed", failure.getMessage());
+    }
+
+    @Override
+    public void testAssumptionFailure(Failure failure) {
+        try {
+            setStatus("skipped", failure.getMessage());
+        } catch (JSONException e) {
+            Log.e(TAG, "Failed to record assumption failure", e);
+        }
+    }
+
+    @Override
+    public void testIgnored(Description description) throws JSONException {
+        testStarted(description);
+        setStatus("skipped", null);
+    }
+
+    @Override
+    public void testFinished(Description description) {
+        setCurrentTest(null);
+    }
+
+    @Override
+    public void testRunFinished(Result result) throws IOException, JSONException {
+        String path = InstrumentationRegistry.getArguments().getString(ARG_RESULT_FILE);
+        File resultFile = path != null
+                ? new File(path)
+                : new File(InstrumentationRegistry.getTargetContext().getExternalFilesDir(null),
+                          DEFAULT_RESULT_FILE);
+        resultFile.getParentFile().mkdirs();
+        JSONObject content = new JSONObject();
+        synchronized (ResultFileListener.class) {
+            content.put("tests", sTests);
+        }
+        try (FileWriter writer = new FileWriter(resultFile)) {
+            writer.write(content.toString());
+        }
+    }
+}
@@ -0,0 +1,141 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2019 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Runs instrumentation tests and reads their structured result file.
+
+The instrumentation package registers a JUnit RunListener (e.g.
+com.android.vts.hal.instrumentation.ResultFileListener of the
+VtsHalInstrumentationResultListener library) that writes the verdict and
+metrics of every test to one JSON file:
+
+    {"tests": [{"name": "Class#method", "status": "passed|failed|skipped",
+                "message": "...", "metrics": {"key": 1.0}}]}
+
+A test that covers several HAL instances at once adds one sub-result per
+instance, named "Class#method@instance".
+
+RunInstrumentation() keeps the am instrument output on the device and only
+reads the result file, so verdicts do not depend on matching the console
+output and large logs are not transferred to the host.
+"""
+
+import json
+import logging
+
+from vts.runners.host import const
+
+RUNNER = 'androidx.test.runner.AndroidJUnitRunner'
+# Default result file, in the external files directory of the package which
+# the instrumentation can write without extra permissions.
+RESULT_FILE = '/sdcard/Android/data/%s/files/instrumentation_result.json'
+LOG_FILE = '/data/local/tmp/%s.instrument.log'
+# Number of lines of the am instrument output shown when no result is found.
+LOG_TAIL_LINES = 50
+
+
+class InstrumentationResult(object):
+    """Parsed content of a result file.
+
+    Attributes:
+        tests: list of dicts with keys name, status, message and metrics.
+    """
+
+    def __init__(self, tests):
+        self.tests = tests
+
+    def GetTests(self, status):
+        """Returns the tests with the given status."""
+        return [test for test in self.tests if test['status'] == status]
+
+    def GetSubResults(self, instance):
+        """Returns the sub-results of a HAL instance.
+
+        Args:
+            instance: string, name of the instance, e.g. 'default'.
+
+        Returns:
+            InstrumentationResult object with the tests named
+            Class#method@instance.
+        """
+        suffix = '@' + instance
+        return InstrumentationResult(
+            [test for test in self.tests if test['name'].endswith(suffix)])
+
+    @property
+    def passed(self):
+        """list of dicts, the passed tests."""
+        return self.GetTests('passed')
+
+    @property
+    def failed(self):
+        """list of dicts, the failed tests."""
+        return self.GetTests('failed')
+
+    @property
+    def skipped(self):
+        """list of dicts, the tests skipped by assumption or @Ignore."""
+        return self.GetTests('skipped')
+
+
+def RunInstrumentation(shell, package, listener, test_class=None, args=None,
+                       result_file=None):
+    """Runs an instrumentation and returns its structured result.
+
+    Args:
+        shell: shell mirror of the device.
+        package: string, package of the instrumentation.
+        listener: string, class name of the RunListener writing the result.
+        test_class: string, class name of the tests to run, None for all.
+        args: dict, extra instrumentation arguments passed with -e.
+        result_file: string, device path the listener writes the result to.
+                     The path must be writable by the instrumentation.
+                     Default is RESULT_FILE of the package.
+
+    Returns:
+        InstrumentationResult object, None if no result file was written,
+        e.g. when the instrumentation crashed.
+    """
+    if not result_file:
+        result_file = RESULT_FILE % package
+    log_file = LOG_FILE % package
+    extras = dict(args or {})
+    extras['listener'] = listener
+    extras['resultFile'] = result_file
+    if test_class:
+        extras['class'] = test_class
+    options = ' '.join("-e %s '%s'" % (key, value)
+                       for key, value in sorted(extras.iteritems()))
+    command = 'am instrument %s -w %s/%s > %s 2>&1' % (options, package,
+                                                       RUNNER, log_file)
+    logging.info('Executing command: %s', command)
+    shell.Execute(['rm -f %s' % result_file, command])
+
+    results = shell.Execute(
+        ['cat %s' % result_file,
+         'tail -n %d %s' % (LOG_TAIL_LINES, log_file)])
+    shell.Execute('rm -f %s %s' % (result_file, log_file))
+    try:
+        tests = json.loads(results[const.STDOUT][0])['tests']
+    except (ValueError, KeyError):
+        logging.error('No instrumentation result in %s, output:\n%s',
+                      result_file, results[const.STDOUT][1])
+        return None
+    for test in tests:
+        test.setdefault('message', '')
+        test.setdefault('metrics', {})
+        if test['status'] == 'failed':
+            logging.error('%s failed: %s', test['name'], test['message'])
+    return InstrumentationResult(tests)
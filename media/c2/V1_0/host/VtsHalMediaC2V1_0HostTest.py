@@ -23,8 +23,10 @@ import argparse
 from vts.runners.host import asserts
 from vts.runners.host import keys
 from vts.runners.host import test_runner
+from vts.testcases.hal import device_snapshot
+from vts.testcases.hal.media import codec_benchmark
+from vts.testcases.hal.media import codec_test_scheduler
 from vts.testcases.template.hal_hidl_gtest import hal_hidl_gtest
-from vts.utils.python.hal import hal_service_name_utils
 
 class VtsHalMediaC2V1_0Host(hal_hidl_gtest.HidlHalGTest):
     """Host test class to run the Media_C2 HAL."""
@@ -35,12 +37,18 @@ class VtsHalMediaC2V1_0Host(hal_hidl_gtest.HidlHalGTest):
     VIDEO_ENC_TEST = "Codec2VideoEnc"
     VIDEO_DEC_TEST = "Codec2VideoDec"
 
+    # (domain, kind) of the components tested by each test suite.
+    suite_capabilities = {AUDIO_ENC_TEST: (2, 2),
+                          AUDIO_DEC_TEST: (2, 1),
+                          VIDEO_ENC_TEST: (1, 2),
+                          VIDEO_DEC_TEST: (1, 1)}
+
     def CreateTestCases(self):
         """Get all registered test components and create test case objects."""
         # Retrieve all available IComponentStore instances
         testable, self.service_names = \
-            hal_service_name_utils.GetHalServiceName(
-                self.shell,
+            device_snapshot.GetHalServiceName(
+                self._dut, self.shell,
                 "android.hardware.media.c2@1.0::IComponentStore",
                 "64" if self._dut.is64Bit else "32")
         self.components = [];
@@ -72,8 +80,48 @@ class VtsHalMediaC2V1_0Host(hal_hidl_gtest.HidlHalGTest):
                               'android.hardware.media.c2@1.0::IComponentStore. ' + \
                               'Tests skipped.')
 
+        self.BuildCapabilityIndex()
+
+        # Encode and decode test cases are re-run and timed if the
+        # codec_benchmark_iterations user param is larger than 0.
+        self.benchmark = codec_benchmark.CodecBenchmark(
+            self.shell,
+            self.getUserParam("codec_benchmark_iterations", default_value=0),
+            ["media.swcodec", "android.hardware.media.c2@1.0-service"])
+
+        # Test cases of different components run concurrently if the
+        # codec_max_parallel user param is larger than 1. IComponentStore
+        # does not report instance limits, so a batch runs at most one
+        # instance of each component. Benchmarks always run one test case at
+        # a time.
+        self.scheduler = codec_test_scheduler.CodecTestScheduler(
+            self.shell, 1 if self.benchmark.enabled else self.getUserParam(
+                "codec_max_parallel", default_value=1))
+
         super(VtsHalMediaC2V1_0Host, self).CreateTestCases()
 
+    def BuildCapabilityIndex(self):
+        """Index the components by owner and capability.
+
+        self.capability_index maps (owner, (domain, kind)) to the matching
+        components, and (owner, None) to all components of the owner.
+        """
+        self.capability_index = {}
+        for component in self.components:
+            owner = component['owner']
+            self.capability_index.setdefault((owner, None), []).append(
+                component)
+            self.capability_index.setdefault(
+                (owner, (component['domain'], component['kind'])),
+                []).append(component)
+
+    def GetSuiteCapability(self, test_suite):
+        """Get the (domain, kind) tested by a test suite, None for all."""
+        for suite, capability in self.suite_capabilities.iteritems():
+            if suite in test_suite:
+                return capability
+        return None
+
     # @Override
     def CreateTestCase(self, path, tag=''):
         """Create a list of VtsHalMediaC2V1_0testCase objects.
@@ -94,39 +142,73 @@ class VtsHalMediaC2V1_0Host(hal_hidl_gtest.HidlHalGTest):
 
         instance_parser = argparse.ArgumentParser()
         instance_parser.add_argument('--hal_service_instance', type=str)
+        # gtest cases of a binary share their args, parse each args once.
+        instance_names = {}
 
         for gtest_case in gtest_cases:
-            test_suite = gtest_case.full_name
-            args = instance_parser.parse_args(gtest_case.args.split())
-            if args.hal_service_instance:
-                instance_name = args.hal_service_instance[args.hal_service_instance.rfind('/')+1:]
-            else:
+            if gtest_case.args not in instance_names:
+                args = instance_parser.parse_args(gtest_case.args.split())
+                if args.hal_service_instance:
+                    instance_names[gtest_case.args] = \
+                        args.hal_service_instance[args.hal_service_instance.rfind('/')+1:]
+                else:
+                    instance_names[gtest_case.args] = None
+            instance_name = instance_names[gtest_case.args]
+            if not instance_name:
                 continue
-            for component in self.components:
-                if instance_name != component['owner']:
-                    continue
-                if self.AUDIO_ENC_TEST in test_suite and \
-                    (component['domain'] != 2 or component['kind'] != 2):
-                    continue
-                if self.AUDIO_DEC_TEST in test_suite and \
-                    (component['domain'] != 2 or component['kind'] != 1):
-                    continue
-                if self.VIDEO_ENC_TEST in test_suite and \
-                    (component['domain'] != 1 or component['kind'] != 2):
-                    continue
-                if self.VIDEO_DEC_TEST in test_suite and \
-                    (component['domain'] != 1 or component['kind'] != 1):
-                    continue
-
+            capability = self.GetSuiteCapability(gtest_case.full_name)
+            for component in self.capability_index.get(
+                    (instance_name, capability), []):
                 test_case = copy.copy(gtest_case)
                 test_case.args += " -I " + component['owner']
                 test_case.args += " -C " + component['name']
                 test_case.name_appendix = '_' + component['owner'] + \
                     '_' + component['name'] + test_case.name_appendix
+                test_case.codec_component = (component['owner'],
+                                             component['name'])
+                test_case.codec_traits = component
+                test_case.codec_capability = capability
                 test_cases.append(test_case)
 
         logging.info("num of test_testcases: %s", len(test_cases))
-        return test_cases
+        # Batches fan out over all IComponentStore instances.
+        return self.scheduler.Schedule(
+            test_cases, lambda test_case: test_case.codec_component,
+            lambda component: 1, lambda component: component[0],
+            is_selected=lambda test_case: self.scheduler.PassesTestFilter(
+                self, test_case))
+
+    # @Override
+    def RunTestCase(self, test_case):
+        """Runs a test case, batched with other components if scheduled.
+
+        Only test cases that passed the test filters are batched, and their
+        batch runs when the first of them is verified. The other test cases
+        run through HidlHalGTest.RunTestCase unless the filters drop them.
+        """
+        if self.benchmark.enabled and test_case.codec_capability:
+            traits = test_case.codec_traits
+            domain, kind = test_case.codec_capability
+            self.VerifyTestResult(
+                test_case,
+                self.benchmark.Run(
+                    test_case, traits['name'], test_case.full_name,
+                    codec_benchmark.MEDIA_TYPE_TO_TOKEN.get(
+                        traits['mediaType'], traits['mediaType']),
+                    is_encoder=kind == 2,
+                    is_video=domain == 1))
+            return
+        if not self.scheduler.IsScheduled(test_case):
+            super(VtsHalMediaC2V1_0Host, self).RunTestCase(test_case)
+            return
+        self.VerifyTestResult(test_case, self.scheduler.GetResults(test_case))
+
+    # @Override
+    def tearDownClass(self):
+        """Reports the codec benchmark results, if any."""
+        if hasattr(self, "benchmark"):
+            self.benchmark.Report(self.web)
+        super(VtsHalMediaC2V1_0Host, self).tearDownClass()
 
 if __name__ == "__main__":
     test_runner.main()
@@ -0,0 +1,243 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2019 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Throughput benchmark for the media codec gtest cases.
+
+CodecBenchmark re-runs the encode and decode gtest cases of each component
+several times back to back. The run time of the gtest process is measured on
+the device, and converted to frames per second with the number of frames of
+the resource stream of the codec pushed to /sdcard/media. The gtest process
+does not report the time of single frames, so the frame times are the mean
+frame time of each run, summarized over the runs. The peak resident memory
+(VmHWM) of the codec HAL processes is reset before and read after every run.
+"""
+
+import logging
+import re
+
+from vts.runners.host import const
+from vts.testcases.hal.script.utils.percentile import Percentile
+
+MEDIA_DIR = '/sdcard/media'
+
+# Maps media types reported by Codec2 components to resource stream tokens.
+MEDIA_TYPE_TO_TOKEN = {
+    'audio/3gpp': 'amrnb',
+    'audio/amr-wb': 'amrwb',
+    'audio/flac': 'flac',
+    'audio/g711-alaw': 'g711alaw',
+    'audio/g711-mlaw': 'g711mulaw',
+    'audio/gsm': 'gsm',
+    'audio/mp4a-latm': 'aac',
+    'audio/mpeg': 'mp3',
+    'audio/opus': 'opus',
+    'audio/raw': 'raw',
+    'audio/vorbis': 'vorbis',
+    'video/3gpp': 'h263',
+    'video/av01': 'av1',
+    'video/avc': 'avc',
+    'video/hevc': 'hevc',
+    'video/mp4v-es': 'mpeg4',
+    'video/mpeg2': 'mpeg2',
+    'video/x-vnd.on2.vp8': 'vp8',
+    'video/x-vnd.on2.vp9': 'vp9',
+}
+
+# Maps OMX role suffixes to resource stream tokens where they differ.
+ROLE_TO_TOKEN = {
+    'g711mlaw': 'g711mulaw',
+}
+
+
+class CodecBenchmark(object):
+    """Measures codec throughput, frame time and memory of gtest cases.
+
+    Attributes:
+        _shell: shell mirror of the device.
+        _iterations: int, number of timed runs of each test case.
+        _hal_processes: list of strings, process names of the codec HALs.
+        _frame_counts: dict, caches frame counts by codec.
+        results: list of dicts, one per benchmarked test case.
+    """
+
+    def __init__(self, shell, iterations, hal_processes):
+        """Initializes the benchmark.
+
+        Args:
+            shell: shell mirror of the device.
+            iterations: int, number of timed runs of each test case, 0 to
+                        disable the benchmark.
+            hal_processes: list of strings, process names of the codec HALs
+                           whose peak memory is reported.
+        """
+        self._shell = shell
+        self._iterations = max(int(iterations), 0)
+        self._hal_processes = hal_processes
+        self._frame_counts = {}
+        self.results = []
+
+    @property
+    def enabled(self):
+        """True if the benchmark mode is on."""
+        return self._iterations > 0
+
+    def GetFrameCount(self, token, is_encoder, is_video):
+        """Returns the number of frames a test case of a codec processes.
+
+        Decoders process the first resource stream of their codec once,
+        which is the lowest resolution one the decode tests use by default,
+        e.g. bbb_avc_176x144_300kbps_60fps rather than the 640x360 stream.
+        Encoders process the raw yuv (video) or pcm (audio) input once.
+
+        Args:
+            token: string, codec token used in the stream names, e.g. 'avc'.
+            is_encoder: bool, whether the component is an encoder.
+            is_video: bool, whether the component is a video codec.
+
+        Returns:
+            int, number of frames, 0 if unknown.
+        """
+        key = (token, is_encoder, is_video)
+        if key in self._frame_counts:
+            return self._frame_counts[key]
+        frames = 0
+        if is_encoder and is_video:
+            results = self._shell.Execute('ls %s/*.yuv' % MEDIA_DIR)
+            match = re.search('_([0-9]+)frames', results[const.STDOUT][0])
+            if match:
+                frames = int(match.group(1))
+        else:
+            if is_encoder:
+                pattern = '%s/*_raw_*.info' % MEDIA_DIR
+            else:
+                pattern = '%s/*_%s_*.info' % (MEDIA_DIR, token)
+            results = self._shell.Execute(
+                'ls %s | grep -v multi_frame | head -n 1 | xargs cat | wc -l' %
+                pattern)
+            try:
+                frames = int(results[const.STDOUT][0].strip())
+            except ValueError:
+                frames = 0
+        self._frame_counts[key] = frames
+        return frames
+
+    def _ResetPeakMemoryCommand(self):
+        """Returns a shell command that resets VmHWM of the HAL processes."""
+        return ('for p in $(pidof %s); do echo 5 > /proc/$p/clear_refs; done' %
+                ' '.join(self._hal_processes))
+
+    def _PeakMemoryCommand(self):
+        """Returns a shell command that prints the summed VmHWM in kB."""
+        return ('for p in $(pidof %s); do grep VmHWM /proc/$p/status; done | '
+                'awk \'{s += $2} END {print s + 0}\'' %
+                ' '.join(self._hal_processes))
+
+    def Run(self, test_case, component, suite, token, is_encoder, is_video):
+        """Runs a test case the configured number of times and records stats.
+
+        Args:
+            test_case: a gtest test case object.
+            component: string, name of the component.
+            suite: string, name of the test suite of the test case.
+            token: string, codec token used in the stream names.
+            is_encoder: bool, whether the component is an encoder.
+            is_video: bool, whether the component is a video codec.
+
+        Returns:
+            dict, command results of the last run, in the format returned by
+            shell.Execute(), for verification of the test result.
+        """
+        commands = test_case.GetRunCommand()
+        if not isinstance(commands, list):
+            commands = [commands]
+
+        frames = self.GetFrameCount(token, is_encoder, is_video)
+        elapsed_seconds = []
+        peak_memory_kb = 0
+        command_results = None
+        for _ in range(self._iterations):
+            results = self._shell.Execute(
+                [self._ResetPeakMemoryCommand(), 'date +%s%N', commands[0],
+                 'date +%s%N', self._PeakMemoryCommand()] + commands[1:])
+            stdout = results[const.STDOUT]
+            try:
+                elapsed_seconds.append(
+                    (int(stdout[3].strip()) - int(stdout[1].strip())) / 1e9)
+                peak_memory_kb = max(peak_memory_kb, int(stdout[4].strip()))
+            except ValueError:
+                logging.warning('Failed to measure %s', test_case)
+            # Keep only the results of the test commands for verification.
+            command_results = {}
+            for key in (const.STDOUT, const.STDERR, const.EXIT_CODE):
+                values = results[key]
+                command_results[key] = [values[2]] + values[5:]
+
+        if elapsed_seconds:
+            # Mean time of a frame in each run, not times of single frames.
+            run_frame_times_ms = [
+                seconds * 1000.0 / frames for seconds in elapsed_seconds
+            ] if frames else []
+            result = {
+                'component': component,
+                'suite': suite,
+                'frames': frames,
+                'runs': len(elapsed_seconds),
+                'seconds_p50': Percentile(elapsed_seconds, 50),
+                'fps_p50': (frames / Percentile(elapsed_seconds, 50)
+                            if frames else 0),
+                'run_frame_ms_p50': (Percentile(run_frame_times_ms, 50)
+                                     if run_frame_times_ms else 0),
+                'run_frame_ms_p90': (Percentile(run_frame_times_ms, 90)
+                                     if run_frame_times_ms else 0),
+                'run_frame_ms_max': (max(run_frame_times_ms)
+                                     if run_frame_times_ms else 0),
+                'peak_memory_kb': peak_memory_kb,
+            }
+            self.results.append(result)
+            logging.info('Codec benchmark: %s', result)
+        return command_results
+
+    def Report(self, web=None):
+        """Logs a summary table and uploads the results as profiling data.
+
+        Args:
+            web: web_utils.WebFeature of the test, None to only log.
+        """
+        if not self.results:
+            return
+        # The frame columns are the mean frame time per run, in ms.
+        logging.info('%-40s %-24s %8s %10s %10s %10s %12s', 'component',
+                     'suite', 'fps', 'run p50', 'run p90', 'run max',
+                     'VmHWM (kB)')
+        for result in self.results:
+            logging.info('%-40s %-24s %8.1f %10.3f %10.3f %10.3f %12d',
+                         result['component'], result['suite'],
+                         result['fps_p50'], result['run_frame_ms_p50'],
+                         result['run_frame_ms_p90'],
+                         result['run_frame_ms_max'], result['peak_memory_kb'])
+        if web and web.enabled:
+            labels = ['%s_%s' % (result['component'], result['suite'])
+                      for result in self.results]
+            web.AddProfilingDataLabeledVector(
+                'codec_fps', labels,
+                [int(result['fps_p50']) for result in self.results],
+                x_axis_label='component',
+                y_axis_label='frames per second')
+            web.AddProfilingDataLabeledVector(
+                'codec_peak_memory_kb', labels,
+                [result['peak_memory_kb'] for result in self.results],
+                x_axis_label='component',
+                y_axis_label='VmHWM (kB)')
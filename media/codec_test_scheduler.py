@@ -0,0 +1,256 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2019 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Concurrent scheduling of codec gtest cases expanded per component.
+
+The media host tests expand every gtest case into one test case per codec
+component. Test cases of different components are independent, so
+CodecTestScheduler groups them into bounded batches whose test cases run as
+separate gtest processes at the same time on the device. Each component
+contributes at most as many test cases to a batch as the number of
+concurrent instances it supports. Components can be grouped, e.g. by the
+HAL service instance that owns them, so that every batch fans out over all
+groups instead of exhausting one instance before starting the next.
+"""
+
+import logging
+
+from vts.runners.host import const
+from vts.runners.host import signals
+
+# Device directory that stores the outputs of a running batch.
+BATCH_OUTPUT_DIR = '/data/local/tmp/codec_test_batch'
+
+
+class CodecTestScheduler(object):
+    """Runs batches of codec gtest cases concurrently.
+
+    Attributes:
+        _shell: shell mirror of the device.
+        _max_parallel: int, maximum number of test cases in a batch.
+        _batches: list of lists of test cases.
+        _batch_of: dict, maps id of a test case to its batch index.
+        _results: dict, maps id of a test case to its command results.
+    """
+
+    def __init__(self, shell, max_parallel):
+        """Initializes the scheduler.
+
+        Args:
+            shell: shell mirror of the device, e.g. self.shell of the test.
+            max_parallel: int, maximum number of concurrent gtest processes.
+                          1 disables concurrent scheduling.
+        """
+        self._shell = shell
+        self._max_parallel = max(int(max_parallel), 1)
+        self._batches = []
+        self._batch_of = {}
+        self._results = {}
+
+    @property
+    def enabled(self):
+        """True if test cases are run concurrently."""
+        return self._max_parallel > 1
+
+    def Schedule(self, test_cases, component_of, instance_limit_of,
+                 group_of=None, is_selected=None):
+        """Groups test cases into batches and orders them batch by batch.
+
+        Only selected test cases are batched. The others are returned first
+        and unscheduled, so that the base test filters them out as usual
+        instead of running them on the device as part of a batch.
+
+        Args:
+            test_cases: list of test cases, e.g. GtestTestCase objects.
+            component_of: function, returns the component key of a test case.
+            instance_limit_of: function, returns the maximum number of
+                               concurrent instances of a component key.
+            group_of: function, returns the group of a component key, e.g.
+                      its HAL service instance. Components of different
+                      groups are interleaved. None for a single group.
+            is_selected: function, returns whether a test case passes the
+                         test filters, e.g. PassesTestFilter. None to batch
+                         all test cases.
+
+        Returns:
+            list of the same test cases, ordered so that the test cases of a
+            batch are adjacent.
+        """
+        if not self.enabled:
+            return test_cases
+
+        ordered = []
+        queues = {}
+        components = []
+        for test_case in test_cases:
+            if is_selected and not is_selected(test_case):
+                ordered.append(test_case)
+                continue
+            component = component_of(test_case)
+            if component not in queues:
+                queues[component] = []
+                components.append(component)
+            queues[component].append(test_case)
+        if group_of:
+            components = self._Interleave(components, group_of)
+
+        while components:
+            batch = []
+            for component in components:
+                room = self._max_parallel - len(batch)
+                if room <= 0:
+                    break
+                count = min(room, max(instance_limit_of(component), 1))
+                batch.extend(queues[component][:count])
+                queues[component] = queues[component][count:]
+            components = [c for c in components if queues[c]]
+            # Rotate so that the next batch starts with other components.
+            if components and batch:
+                components = components[1:] + components[:1]
+
+            batch_index = len(self._batches)
+            for index, test_case in enumerate(batch):
+                self._batch_of[id(test_case)] = batch_index
+                # Concurrent gtest processes must not share an xml output.
+                output_file_path = getattr(test_case, 'output_file_path',
+                                           None)
+                if output_file_path:
+                    test_case.output_file_path = '%s_%d_%d' % (
+                        output_file_path, batch_index, index)
+            self._batches.append(batch)
+            ordered.extend(batch)
+
+        logging.info('Scheduled %d test cases in %d batches of at most %d.',
+                     len(self._batch_of), len(self._batches),
+                     self._max_parallel)
+        return ordered
+
+    @staticmethod
+    def PassesTestFilter(test, test_case):
+        """Returns whether the base test would run a test case.
+
+        Args:
+            test: the BaseTestClass object that runs the test case.
+            test_case: a test case named by str(), e.g. a GtestTestCase.
+        """
+        try:
+            test.filterOneTest(str(test_case))
+        except (signals.TestSilent, signals.TestSkip):
+            return False
+        return True
+
+    @staticmethod
+    def _Interleave(components, group_of):
+        """Orders components round-robin over their groups.
+
+        Args:
+            components: list of component keys.
+            group_of: function, returns the group of a component key.
+
+        Returns:
+            list of the same component keys, e.g. [a1, b1, a2, b2, a3] for
+            the components a1, a2, a3 of group a and b1, b2 of group b.
+        """
+        groups = []
+        members = {}
+        for component in components:
+            group = group_of(component)
+            if group not in members:
+                members[group] = []
+                groups.append(group)
+            members[group].append(component)
+        interleaved = []
+        for index in range(max(len(members[group]) for group in groups)):
+            for group in groups:
+                if index < len(members[group]):
+                    interleaved.append(members[group][index])
+        return interleaved
+
+    def IsScheduled(self, test_case):
+        """Returns whether the test case belongs to a batch."""
+        return id(test_case) in self._batch_of
+
+    def GetResults(self, test_case):
+        """Returns the command results of a scheduled test case.
+
+        Runs the batch of the test case if it did not run yet.
+
+        Args:
+            test_case: a test case passed to Schedule().
+
+        Returns:
+            dict in the format returned by shell.Execute(), i.e. lists of
+            stdout, stderr and exit code for each command of the test case.
+        """
+        if id(test_case) not in self._results:
+            self._RunBatch(self._batches[self._batch_of[id(test_case)]])
+        return self._results.pop(id(test_case))
+
+    def _RunBatch(self, batch):
+        """Runs every test case of a batch concurrently on the device.
+
+        Each test case runs its commands sequentially in a background
+        subshell that records the stdout, stderr and exit code of every
+        command. All outputs are read back in one shell round trip.
+
+        Args:
+            batch: list of test cases.
+        """
+        run_commands = []
+        for test_case in batch:
+            commands = test_case.GetRunCommand()
+            if not isinstance(commands, list):
+                commands = [commands]
+            run_commands.append(commands)
+
+        script = ['rm -rf %s' % BATCH_OUTPUT_DIR,
+                  'mkdir -p %s' % BATCH_OUTPUT_DIR]
+        for index, commands in enumerate(run_commands):
+            steps = []
+            for step, command in enumerate(commands):
+                output = '%s/%d_%d' % (BATCH_OUTPUT_DIR, index, step)
+                steps.append('{ %s ; } > %s.out 2> %s.err; echo $? > %s.exit' %
+                             (command, output, output, output))
+            script.append('( %s ) &' % '; '.join(steps))
+        script.append('wait')
+        self._shell.Execute('\n'.join(script))
+
+        read_commands = []
+        for index, commands in enumerate(run_commands):
+            for step in range(len(commands)):
+                output = '%s/%d_%d' % (BATCH_OUTPUT_DIR, index, step)
+                read_commands.extend([
+                    'cat %s.out' % output,
+                    'cat %s.err' % output,
+                    'cat %s.exit' % output
+                ])
+        read_results = self._shell.Execute(read_commands)
+        self._shell.Execute('rm -rf %s' % BATCH_OUTPUT_DIR)
+
+        position = 0
+        for test_case, commands in zip(batch, run_commands):
+            results = {const.STDOUT: [], const.STDERR: [], const.EXIT_CODE: []}
+            for _ in commands:
+                stdout = read_results[const.STDOUT]
+                results[const.STDOUT].append(stdout[position])
+                results[const.STDERR].append(stdout[position + 1])
+                try:
+                    exit_code = int(stdout[position + 2].strip())
+                except ValueError:
+                    exit_code = 1
+                results[const.EXIT_CODE].append(exit_code)
+                position += 3
+            self._results[id(test_case)] = results
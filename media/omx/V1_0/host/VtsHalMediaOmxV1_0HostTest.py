@@ -22,6 +22,8 @@ import time
 from vts.runners.host import asserts
 from vts.runners.host import keys
 from vts.runners.host import test_runner
+from vts.testcases.hal.media import codec_benchmark
+from vts.testcases.hal.media import codec_test_scheduler
 from vts.testcases.template.hal_hidl_gtest import hal_hidl_gtest
 
 
@@ -62,6 +64,12 @@ class VtsHalMediaOmxV1_0Host(hal_hidl_gtest.HidlHalGTest):
                        "video_decoder.vp8",
                        "video_decoder.vp9"]
 
+    # Role prefix required by each test suite.
+    suite_role_kinds = {AUDIO_ENC_TEST: "audio_encoder",
+                        AUDIO_DEC_TEST: "audio_decoder",
+                        VIDEO_ENC_TEST: "video_encoder",
+                        VIDEO_DEC_TEST: "video_decoder"}
+
     def CreateTestCases(self):
         """Get all registered test components and create test case objects."""
         # Init the IOmx hal.
@@ -81,9 +89,85 @@ class VtsHalMediaOmxV1_0Host(hal_hidl_gtest.HidlHalGTest):
         self.components = {}
         for node in nodeList:
             self.components[node['mName']] = node['mRoles']
+        self.BuildCapabilityIndex()
+
+        # Encode and decode test cases are re-run and timed if the
+        # codec_benchmark_iterations user param is larger than 0.
+        self.benchmark = codec_benchmark.CodecBenchmark(
+            self.shell,
+            self.getUserParam("codec_benchmark_iterations", default_value=0),
+            ["media.codec", "media.swcodec"])
+
+        # Test cases of different components run concurrently if the
+        # codec_max_parallel user param is larger than 1. Benchmarks always
+        # run one test case at a time.
+        self.scheduler = codec_test_scheduler.CodecTestScheduler(
+            self.shell, 1 if self.benchmark.enabled else self.getUserParam(
+                "codec_max_parallel", default_value=1))
+        self.instance_limits = {}
+        if self.scheduler.enabled:
+            self.instance_limits = self.GetInstanceLimits()
 
         super(VtsHalMediaOmxV1_0Host, self).CreateTestCases()
 
+    def BuildCapabilityIndex(self):
+        """Index the (component, role) pairs by the test suites they serve.
+
+        self.capability_index maps COMPONENT_TEST to every pair, each key of
+        suite_role_kinds to the whitelisted pairs of the matching role kind,
+        and None to all whitelisted pairs (for other test suites).
+        """
+        self.capability_index = {self.COMPONENT_TEST: [], None: []}
+        for kind in self.suite_role_kinds:
+            self.capability_index[kind] = []
+        role_kinds = dict((role_kind, suite) for suite, role_kind in
+                          self.suite_role_kinds.iteritems())
+        whitelist = set(self.whitelist_roles)
+        for component in sorted(self.components):
+            for role in self.components[component]:
+                self.capability_index[self.COMPONENT_TEST].append(
+                    (component, role))
+                if role not in whitelist:
+                    continue
+                self.capability_index[None].append((component, role))
+                suite = role_kinds.get(role.split('.')[0])
+                if suite:
+                    self.capability_index[suite].append((component, role))
+
+    def GetSuiteKind(self, test_suite):
+        """Get the capability index key of a test suite."""
+        if self.COMPONENT_TEST in test_suite:
+            return self.COMPONENT_TEST
+        for suite in self.suite_role_kinds:
+            if suite in test_suite:
+                return suite
+        return None
+
+    def GetInstanceLimits(self):
+        """Get the max-concurrent-instances of the nodes from IOmxStore.
+
+        Returns:
+            dict, maps node names to their max concurrent instances. Nodes
+            that do not advertise a limit are not included.
+        """
+        instance_limits = {}
+        try:
+            self._dut.hal.InitHidlHal(
+                target_type="media_omx",
+                target_basepaths=self._dut.libPaths,
+                target_version=1.0,
+                target_package="android.hardware.media.omx",
+                target_component_name="IOmxStore",
+                bits=64 if self._dut.is64Bit else 32)
+            for role in self._dut.hal.media_omx.listRoles():
+                for node in role['nodes']:
+                    for attr in node['attributes']:
+                        if attr['key'] == 'max-concurrent-instances':
+                            instance_limits[node['name']] = int(attr['value'])
+        except Exception as e:
+            logging.warning("Failed to query IOmxStore node limits: %s", e)
+        return instance_limits
+
     # @Override
     def CreateTestCase(self, path, tag=''):
         """Create a list of VtsHalMediaOmxV1_0testCase objects.
@@ -103,27 +187,53 @@ class VtsHalMediaOmxV1_0Host(hal_hidl_gtest.HidlHalGTest):
         test_cases = []
 
         for gtest_case in gtest_cases:
-            test_suite = gtest_case.full_name
-            for component, roles in self.components.iteritems():
-                for role in roles:
-                    if not self.COMPONENT_TEST in test_suite and not role in self.whitelist_roles:
-                        continue
-                    if self.AUDIO_ENC_TEST in test_suite and not "audio_encoder" in role:
-                        continue
-                    if self.AUDIO_DEC_TEST in test_suite and not "audio_decoder" in role:
-                        continue
-                    if self.VIDEO_ENC_TEST in test_suite and not "video_encoder" in role:
-                        continue
-                    if self.VIDEO_DEC_TEST in test_suite and not "video_decoder" in role:
-                        continue
-
-                    test_case = copy.copy(gtest_case)
-                    test_case.args += " -C " + component
-                    test_case.args += " -R " + role
-                    test_case.name_appendix = '_' + component + '_' + role + test_case.name_appendix
-                    test_cases.append(test_case)
+            suite_kind = self.GetSuiteKind(gtest_case.full_name)
+            for component, role in self.capability_index[suite_kind]:
+                test_case = copy.copy(gtest_case)
+                test_case.args += " -C " + component
+                test_case.args += " -R " + role
+                test_case.name_appendix = '_' + component + '_' + role + test_case.name_appendix
+                test_case.codec_component = component
+                test_case.codec_role = role
+                test_case.codec_suite = suite_kind
+                test_cases.append(test_case)
         logging.info("num of test_testcases: %s", len(test_cases))
-        return test_cases
+        return self.scheduler.Schedule(
+            test_cases, lambda test_case: test_case.codec_component,
+            lambda component: self.instance_limits.get(component, 1),
+            is_selected=lambda test_case: self.scheduler.PassesTestFilter(
+                self, test_case))
+
+    # @Override
+    def RunTestCase(self, test_case):
+        """Runs a test case, batched with other components if scheduled.
+
+        Only test cases that passed the test filters are batched, and their
+        batch runs when the first of them is verified. The other test cases
+        run through HidlHalGTest.RunTestCase unless the filters drop them.
+        """
+        if self.benchmark.enabled and test_case.codec_suite in self.suite_role_kinds:
+            role_kind, codec = test_case.codec_role.split('.', 1)
+            self.VerifyTestResult(
+                test_case,
+                self.benchmark.Run(
+                    test_case, test_case.codec_component,
+                    test_case.codec_suite,
+                    codec_benchmark.ROLE_TO_TOKEN.get(codec, codec),
+                    is_encoder=role_kind.endswith("encoder"),
+                    is_video=role_kind.startswith("video")))
+            return
+        if not self.scheduler.IsScheduled(test_case):
+            super(VtsHalMediaOmxV1_0Host, self).RunTestCase(test_case)
+            return
+        self.VerifyTestResult(test_case, self.scheduler.GetResults(test_case))
+
+    # @Override
+    def tearDownClass(self):
+        """Reports the codec benchmark results, if any."""
+        if hasattr(self, "benchmark"):
+            self.benchmark.Report(self.web)
+        super(VtsHalMediaOmxV1_0Host, self).tearDownClass()
 
 
 if __name__ == "__main__":
@@ -17,11 +17,14 @@
 """This module is for VTS test cases involving IOmxStore and IOmx::listNodes().
 
 VtsHalMediaOmxStoreV1_0Host derives from base_test.BaseTestClass. It contains
-two independent tests: testListServiceAttributes() and
-testQueryCodecInformation(). The first one tests
+three independent tests: testListServiceAttributes(),
+testQueryCodecInformation() and testMeasuredFrameRates(). The first one tests
 IOmxStore::listServiceAttributes() while the second one test multiple functions
 in IOmxStore as well as check the consistency of the return values with
-IOmx::listNodes().
+IOmx::listNodes(). The third one, which only runs if the
+omx_frame_rate_frames user param is set and the frame rate instrumentation
+(VtsHalMediaOmxStoreV1_0FrameRateTestCases.apk) is installed, checks that the
+video nodes reach the measured frame rates they advertise.
 
 """
 
@@ -29,11 +32,20 @@ import logging
 import re
 
 from vts.runners.host import asserts
+from vts.runners.host import const
 from vts.runners.host import test_runner
+from vts.testcases.hal import instrumentation_result
 from vts.testcases.template.hal_hidl_host_test import hal_hidl_host_test
 
 OMXSTORE_V1_0_HAL = "android.hardware.media.omx@1.0::IOmxStore"
 
+# Instrumentation that measures the frame rate of a codec at given sizes.
+FRAME_RATE_PACKAGE = 'com.android.media.omx.vts'
+FRAME_RATE_TEST = FRAME_RATE_PACKAGE + '.MeasuredFrameRateTest'
+FRAME_RATE_LISTENER = 'com.android.vts.hal.instrumentation.ResultFileListener'
+MEASURED_FRAME_RATE_RE = re.compile(
+    r'measured-frame-rate-([0-9]+)x([0-9]+)-range$')
+
 class VtsHalMediaOmxStoreV1_0Host(hal_hidl_host_test.HalHidlHostTest):
     """Host test class to run the Media_OmxStore HAL."""
 
@@ -479,5 +491,104 @@ class VtsHalMediaOmxStoreV1_0Host(hal_hidl_host_test.HalHidlHostTest):
                     'Node "' + node + '" does not start with ' +
                     'prefix "' + prefix + '".')
 
+    def getMeasuredFrameRates(self):
+        """Collects the measured-frame-rate attributes of the video nodes.
+
+        Returns:
+            dict, maps (node name, mime type, is encoder) tuples to dicts
+            that map advertised sizes as 'WxH' strings to (low, high) frame
+            rate ranges.
+        """
+        measured = {}
+        for role in self.omxstore.listRoles():
+            if not role['type'].startswith('video/'):
+                continue
+            for node in role['nodes']:
+                for attr in node['attributes']:
+                    match = MEASURED_FRAME_RATE_RE.match(attr['key'])
+                    if not match:
+                        continue
+                    bounds = [int(bound) for bound in attr['value'].split('-')]
+                    key = (node['name'], role['type'], role['isEncoder'])
+                    size = '%sx%s' % match.groups()
+                    measured.setdefault(key, {})[size] = (bounds[0],
+                                                          bounds[-1])
+        return measured
+
+    def testMeasuredFrameRates(self):
+        """Verify the measured frame rates advertised by the video nodes.
+
+        For each video node with measured-frame-rate-WxH-range attributes,
+        an instrumentation encodes synthetic frames (encoders) or decodes a
+        stream encoded from them (decoders) at each advertised size and
+        measures the sustained frame rate. A size fails if the measured rate
+        is below low / tolerance or above high * tolerance, where tolerance
+        is the omx_frame_rate_tolerance user param. Sizes that could not be
+        measured are reported but do not fail.
+
+        The default configure neither installs the instrumentation nor
+        allows the time this takes, see AndroidTest.xml.
+        """
+        frames = int(self.getUserParam('omx_frame_rate_frames',
+                                       default_value=0))
+        asserts.skipIf(frames <= 0,
+                       'Set omx_frame_rate_frames to verify frame rates.')
+        results = self.shell.Execute('pm path %s' % FRAME_RATE_PACKAGE)
+        asserts.skipIf(
+            results[const.EXIT_CODE][0] != 0,
+            '%s is not installed, install '
+            'VtsHalMediaOmxStoreV1_0FrameRateTestCases.apk to verify frame '
+            'rates.' % FRAME_RATE_PACKAGE)
+        tolerance = float(self.getUserParam('omx_frame_rate_tolerance',
+                                            default_value=1.5))
+
+        violations = []
+        unverified = []
+        labels = []
+        values = []
+        measured = self.getMeasuredFrameRates()
+        for (node, mime, is_encoder), ranges in sorted(measured.iteritems()):
+            result = instrumentation_result.RunInstrumentation(
+                self.shell, FRAME_RATE_PACKAGE, FRAME_RATE_LISTENER,
+                FRAME_RATE_TEST,
+                {'codec': node,
+                 'mime': mime,
+                 'encoder': 'true' if is_encoder else 'false',
+                 'sizes': ','.join(sorted(ranges)),
+                 'frames': frames})
+            if not result or not result.tests:
+                violations.append('%s: no frame rate result' % node)
+                continue
+            test = result.tests[0]
+            if test['status'] == 'failed':
+                violations.append('%s: %s' % (node, test['message']))
+                continue
+            for size, (low, high) in sorted(ranges.iteritems()):
+                fps = test['metrics'].get('fps_' + size)
+                if fps is None:
+                    unverified.append('%s %s' % (node, size))
+                    continue
+                logging.info('%s %s: %.1f fps, advertised %d-%d', node, size,
+                             fps, low, high)
+                labels.append('%s_%s' % (node, size))
+                values.append(int(fps))
+                if fps < low / tolerance or fps > high * tolerance:
+                    violations.append('%s %s: %.1f fps, advertised %d-%d' %
+                                      (node, size, fps, low, high))
+
+        if unverified:
+            logging.warning('Frame rates not measured: %s',
+                            ', '.join(unverified))
+        if self.web.enabled and labels:
+            self.web.AddProfilingDataLabeledVector(
+                'omx_measured_frame_rate', labels, values,
+                x_axis_label='node and size',
+                y_axis_label='frames per second')
+        asserts.assertEqual(
+            [], violations,
+            'Measured frame rates outside the advertised ranges:\n' +
+            '\n'.join(violations))
+
+
 if __name__ == '__main__':
     test_runner.main()
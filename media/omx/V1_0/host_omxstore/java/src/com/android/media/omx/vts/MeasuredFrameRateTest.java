@@ -0,0 +1,395 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.media.omx.vts;
+
+import static junit.framework.TestCase.assertNotNull;
+
+import android.media.Image;
+import android.media.MediaCodec;
+import android.media.MediaCodecInfo;
+import android.media.MediaCodecInfo.CodecCapabilities;
+import android.media.MediaCodecInfo.VideoCapabilities;
+import android.media.MediaCodecList;
+import android.media.MediaFormat;
+import android.os.Bundle;
+import android.os.SystemClock;
+import android.util.Log;
+import androidx.test.InstrumentationRegistry;
+import androidx.test.filters.LargeTest;
+import androidx.test.runner.AndroidJUnit4;
+import com.android.vts.hal.instrumentation.ResultFileListener;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import org.junit.Test;
+import org.junit.runner.RunWith;
+
+/**
+ * Measures the sustained frame rate of a video codec at the sizes it advertises.
+ *
+ * The codec, its media type and the sizes are passed as instrumentation arguments. Encoders
+ * encode synthetic frames. Decoders decode a stream that another encoder of the same media
+ * type produced from the synthetic frames before the measurement. The frame rate of each size
+ * is reported as the metric {@code fps_WxH} through {@link ResultFileListener}. Sizes the
+ * codec does not support, or that no encoder can produce a stream for, have no metric.
+ */
+@RunWith(AndroidJUnit4.class)
+public class MeasuredFrameRateTest {
+    private static final String TAG = "MeasuredFrameRateTest";
+    private static final String ARG_CODEC = "codec";
+    private static final String ARG_MIME = "mime";
+    private static final String ARG_ENCODER = "encoder";
+    private static final String ARG_SIZES = "sizes";
+    private static final String ARG_FRAMES = "frames";
+
+    private static final int FRAME_RATE = 30;
+    private static final int I_FRAME_INTERVAL_SEC = 1;
+    private static final float BITS_PER_PIXEL = 0.1f;
+    // Output frames not measured, so that codec start-up is not counted.
+    private static final int WARMUP_FRAMES = 10;
+    private static final long DEQUEUE_TIMEOUT_US = 10000;
+    // Upper bound of the time a single frame may take before the run is abandoned.
+    private static final long FRAME_TIMEOUT_NS = 1000000000L;
+    // Distinct synthetic frames, rendered while the output is still in warm-up and then
+    // bulk-copied, so that rendering does not slow down the measured frames.
+    private static final int PRERENDERED_FRAMES = 8;
+
+    /** An encoded access unit of the synthetic stream. */
+    private static class AccessUnit {
+        final byte[] data;
+        final int flags;
+        final long presentationTimeUs;
+
+        AccessUnit(byte[] data, int flags, long presentationTimeUs) {
+            this.data = data;
+            this.flags = flags;
+            this.presentationTimeUs = presentationTimeUs;
+        }
+    }
+
+    /** Counts the output frames of a codec and the time the measured ones took. */
+    private static class FrameCounter {
+        private int mFrames;
+        private long mStartNs;
+        private long mEndNs;
+
+        void onFrame() {
+            ++mFrames;
+            mEndNs = SystemClock.elapsedRealtimeNanos();
+            if (mFrames == WARMUP_FRAMES) {
+                mStartNs = mEndNs;
+            }
+        }
+
+        /** Returns the frame rate after the warm-up, 0 if too few frames were output. */
+        double getFrameRate() {
+            if (mFrames <= WARMUP_FRAMES || mEndNs <= mStartNs) {
+                return 0;
+            }
+            return (mFrames - WARMUP_FRAMES) * 1e9 / (mEndNs - mStartNs);
+        }
+    }
+
+    @Test
+    @LargeTest
+    public void testMeasuredFrameRates() throws IOException {
+        Bundle args = InstrumentationRegistry.getArguments();
+        String codecName = args.getString(ARG_CODEC);
+        String mime = args.getString(ARG_MIME);
+        boolean isEncoder = Boolean.parseBoolean(args.getString(ARG_ENCODER));
+        int frames = Integer.parseInt(args.getString(ARG_FRAMES, "300"));
+
+        MediaCodecInfo info = findCodec(codecName);
+        assertNotNull("Codec " + codecName + " is not listed", info);
+        VideoCapabilities caps = info.getCapabilitiesForType(mime).getVideoCapabilities();
+        assertNotNull("Codec " + codecName + " is not a video codec", caps);
+
+        for (String size : args.getString(ARG_SIZES).split(",")) {
+            String[] dimensions = size.split("x");
+            int width = Integer.parseInt(dimensions[0]);
+            int height = Integer.parseInt(dimensions[1]);
+            if (!caps.isSizeSupported(width, height)) {
+                Log.w(TAG, codecName + " does not support " + size);
+                continue;
+            }
+            double frameRate;
+            if (isEncoder) {
+                frameRate = measureEncoder(codecName, mime, width, height, frames);
+            } else {
+                frameRate = measureDecoder(codecName, mime, width, height, frames);
+            }
+            Log.i(TAG, codecName + " " + size + ": " + frameRate + " fps");
+            if (frameRate > 0) {
+                ResultFileListener.addMetric("fps_" + size, frameRate);
+            }
+        }
+    }
+
+    private static MediaCodecInfo findCodec(String name) {
+        for (MediaCodecInfo info : new MediaCodecList(MediaCodecList.ALL_CODECS).getCodecInfos()) {
+            if (info.getName().equals(name)) {
+                return info;
+            }
+        }
+        return null;
+    }
+
+    /** Returns an encoder other than {@code exclude} that supports the size, or null. */
+    private static String findEncoder(String mime, int width, int height, String exclude) {
+        for (MediaCodecInfo info :
+                new MediaCodecList(MediaCodecList.REGULAR_CODECS).getCodecInfos()) {
+            if (!info.isEncoder() || info.getName().equals(exclude)) {
+                continue;
+            }
+            for (String type : info.getSupportedTypes()) {
+                if (type.equalsIgnoreCase(mime) && info.getCapabilitiesForType(type)
+                        .getVideoCapabilities().isSizeSupported(width, height)) {
+                    return info.getName();
+                }
+            }
+        }
+        return null;
+    }
+
+    private static MediaFormat createEncoderFormat(MediaCodec encoder, String mime, int width,
+            int height) {
+        VideoCapabilities caps =
+                encoder.getCodecInfo().getCapabilitiesForType(mime).getVideoCapabilities();
+        MediaFormat format = MediaFormat.createVideoFormat(mime, width, height);
+        format.setInteger(MediaFormat.KEY_COLOR_FORMAT,
+                CodecCapabilities.COLOR_FormatYUV420Flexible);
+        format.setInteger(MediaFormat.KEY_BIT_RATE, caps.getBitrateRange().clamp(
+                (int) (width * height * FRAME_RATE * BITS_PER_PIXEL)));
+        format.setInteger(MediaFormat.KEY_FRAME_RATE, FRAME_RATE);
+        format.setInteger(MediaFormat.KEY_I_FRAME_INTERVAL, I_FRAME_INTERVAL_SEC);
+        return format;
+    }
+
+    /** Fills a YUV 420 image with a diagonal gradient that moves with the frame index. */
+    private static void fillImage(Image image, int frameIndex) {
+        Image.Plane[] planes = image.getPlanes();
+        for (int p = 0; p < planes.length; ++p) {
+            int shift = p == 0 ? 0 : 1;
+            int planeWidth = image.getWidth() >> shift;
+            int planeHeight = image.getHeight() >> shift;
+            ByteBuffer buffer = planes[p].getBuffer();
+            int rowStride = planes[p].getRowStride();
+            int pixelStride = planes[p].getPixelStride();
+            byte[] pattern = new byte[planeWidth + 256];
+            for (int i = 0; i < pattern.length; ++i) {
+                pattern[i] = (byte) (i + p * 64);
+            }
+            for (int y = 0; y < planeHeight; ++y) {
+                int offset = (y + frameIndex * 4) & 0xff;
+                if (pixelStride == 1) {
+                    buffer.position(y * rowStride);
+                    buffer.put(pattern, offset, planeWidth);
+                } else {
+                    for (int x = 0; x < planeWidth; ++x) {
+                        buffer.put(y * rowStride + x * pixelStride, pattern[offset + x]);
+                    }
+                }
+            }
+        }
+    }
+
+    /** Synthetic input frames, rendered once and then copied into the input images. */
+    private static class FrameSource {
+        private final byte[][][] mFrames = new byte[PRERENDERED_FRAMES][][];
+        private final int[][] mLayouts = new int[PRERENDERED_FRAMES][];
+
+        /** Returns the row stride, pixel stride and size of every plane of an image. */
+        private static int[] getLayout(Image.Plane[] planes) {
+            int[] layout = new int[planes.length * 3];
+            for (int p = 0; p < planes.length; ++p) {
+                layout[p * 3] = planes[p].getRowStride();
+                layout[p * 3 + 1] = planes[p].getPixelStride();
+                layout[p * 3 + 2] = planes[p].getBuffer().limit();
+            }
+            return layout;
+        }
+
+        void fill(Image image, int frameIndex) {
+            int slot = frameIndex % PRERENDERED_FRAMES;
+            Image.Plane[] planes = image.getPlanes();
+            int[] layout = getLayout(planes);
+            if (mFrames[slot] == null || !Arrays.equals(mLayouts[slot], layout)) {
+                fillImage(image, slot);
+                // Copied after all planes are filled, since the chroma planes of semi-planar
+                // images share their bytes.
+                mFrames[slot] = new byte[planes.length][];
+                for (int p = 0; p < planes.length; ++p) {
+                    ByteBuffer buffer = planes[p].getBuffer().duplicate();
+                    buffer.rewind();
+                    mFrames[slot][p] = new byte[buffer.remaining()];
+                    buffer.get(mFrames[slot][p]);
+                }
+                mLayouts[slot] = layout;
+                return;
+            }
+            for (int p = 0; p < planes.length; ++p) {
+                ByteBuffer buffer = planes[p].getBuffer().duplicate();
+                buffer.rewind();
+                buffer.put(mFrames[slot][p]);
+            }
+        }
+    }
+
+    private static long presentationTimeUs(int frameIndex) {
+        return frameIndex * 1000000L / FRAME_RATE;
+    }
+
+    /**
+     * Encodes synthetic frames.
+     *
+     * @param units receives the encoded access units, or null to discard them.
+     * @return the output frame counter.
+     */
+    private static FrameCounter encode(MediaCodec encoder, int frames, List<AccessUnit> units) {
+        MediaCodec.BufferInfo info = new MediaCodec.BufferInfo();
+        FrameCounter counter = new FrameCounter();
+        FrameSource source = new FrameSource();
+        long deadlineNs = SystemClock.elapsedRealtimeNanos() + (frames + 1) * FRAME_TIMEOUT_NS;
+        int queued = 0;
+        boolean outputDone = false;
+        while (!outputDone) {
+            if (SystemClock.elapsedRealtimeNanos() > deadlineNs) {
+                throw new IllegalStateException("Encoder timed out");
+            }
+            if (queued <= frames) {
+                int index = encoder.dequeueInputBuffer(DEQUEUE_TIMEOUT_US);
+                if (index >= 0) {
+                    if (queued == frames) {
+                        encoder.queueInputBuffer(index, 0, 0, presentationTimeUs(queued),
+                                MediaCodec.BUFFER_FLAG_END_OF_STREAM);
+                    } else {
+                        Image image = encoder.getInputImage(index);
+                        source.fill(image, queued);
+                        encoder.queueInputBuffer(index, 0,
+                                image.getWidth() * image.getHeight() * 3 / 2,
+                                presentationTimeUs(queued), 0);
+                    }
+                    ++queued;
+                }
+            }
+            int index = encoder.dequeueOutputBuffer(info, DEQUEUE_TIMEOUT_US);
+            if (index < 0) {
+                continue;
+            }
+            if (info.size > 0) {
+                if ((info.flags & MediaCodec.BUFFER_FLAG_CODEC_CONFIG) == 0) {
+                    counter.onFrame();
+                }
+                if (units != null) {
+                    byte[] data = new byte[info.size];
+                    ByteBuffer buffer = encoder.getOutputBuffer(index);
+                    buffer.position(info.offset);
+                    buffer.get(data);
+                    units.add(new AccessUnit(data,
+                            info.flags & ~MediaCodec.BUFFER_FLAG_END_OF_STREAM,
+                            info.presentationTimeUs));
+                }
+            }
+            outputDone = (info.flags & MediaCodec.BUFFER_FLAG_END_OF_STREAM) != 0;
+            encoder.releaseOutputBuffer(index, false);
+        }
+        return counter;
+    }
+
+    /** Decodes access units into byte buffers and returns the output frame counter. */
+    private static FrameCounter decode(MediaCodec decoder, List<AccessUnit> units) {
+        MediaCodec.BufferInfo info = new MediaCodec.BufferInfo();
+        FrameCounter counter = new FrameCounter();
+        long deadlineNs =
+                SystemClock.elapsedRealtimeNanos() + (units.size() + 1) * FRAME_TIMEOUT_NS;
+        int queued = 0;
+        boolean outputDone = false;
+        while (!outputDone) {
+            if (SystemClock.elapsedRealtimeNanos() > deadlineNs) {
+                throw new IllegalStateException("Decoder timed out");
+            }
+            if (queued <= units.size()) {
+                int index = decoder.dequeueInputBuffer(DEQUEUE_TIMEOUT_US);
+                if (index >= 0) {
+                    if (queued == units.size()) {
+                        decoder.queueInputBuffer(index, 0, 0, 0,
+                                MediaCodec.BUFFER_FLAG_END_OF_STREAM);
+                    } else {
+                        AccessUnit unit = units.get(queued);
+                        decoder.getInputBuffer(index).put(unit.data);
+                        decoder.queueInputBuffer(index, 0, unit.data.length,
+                                unit.presentationTimeUs, unit.flags);
+                    }
+                    ++queued;
+                }
+            }
+            int index = decoder.dequeueOutputBuffer(info, DEQUEUE_TIMEOUT_US);
+            if (index < 0) {
+                continue;
+            }
+            if (info.size > 0) {
+                counter.onFrame();
+            }
+            outputDone = (info.flags & MediaCodec.BUFFER_FLAG_END_OF_STREAM) != 0;
+            decoder.releaseOutputBuffer(index, false);
+        }
+        return counter;
+    }
+
+    private static double measureEncoder(String codecName, String mime, int width, int height,
+            int frames) throws IOException {
+        MediaCodec encoder = MediaCodec.createByCodecName(codecName);
+        try {
+            encoder.configure(createEncoderFormat(encoder, mime, width, height), null, null,
+                    MediaCodec.CONFIGURE_FLAG_ENCODE);
+            encoder.start();
+            return encode(encoder, frames, null).getFrameRate();
+        } finally {
+            encoder.release();
+        }
+    }
+
+    private static double measureDecoder(String codecName, String mime, int width, int height,
+            int frames) throws IOException {
+        String encoderName = findEncoder(mime, width, height, codecName);
+        if (encoderName == null) {
+            Log.w(TAG, "No encoder produces " + mime + " at " + width + "x" + height);
+            return 0;
+        }
+        List<AccessUnit> units = new ArrayList<>();
+        MediaCodec encoder = MediaCodec.createByCodecName(encoderName);
+        try {
+            encoder.configure(createEncoderFormat(encoder, mime, width, height), null, null,
+                    MediaCodec.CONFIGURE_FLAG_ENCODE);
+            encoder.start();
+            encode(encoder, frames, units);
+        } finally {
+            encoder.release();
+        }
+
+        MediaCodec decoder = MediaCodec.createByCodecName(codecName);
+        try {
+            decoder.configure(MediaFormat.createVideoFormat(mime, width, height), null, null, 0);
+            decoder.start();
+            return decode(decoder, units).getFrameRate();
+        } finally {
+            decoder.release();
+        }
+    }
+}
@@ -16,42 +16,158 @@
 #
 
 import logging
-import re
 
-from time import sleep
 from vts.runners.host import asserts
-from vts.runners.host import const
 from vts.runners.host import test_runner
+from vts.testcases.hal import device_snapshot
+from vts.testcases.hal import instrumentation_result
 from vts.testcases.template.hal_hidl_host_test import hal_hidl_host_test
 
 
 class VtsHalNeuralnetworksV1_2Benchmark(hal_hidl_host_test.HalHidlHostTest):
-    """A test case that runs the accuracy benchmark for every NN device driver."""
+    """A test case that runs the accuracy benchmark for every NN device driver.
 
-    TEST_HAL_SERVICES = {"android.hardware.neuralnetworks@1.2::IDevice"}
+    If the nn_instance_fanout user param is true, the accuracy benchmark runs
+    once for all driver instances concurrently, and the test of each instance
+    checks the sub-results attributed to it.
+
+    Attributes:
+        PACKAGE: string, package of the benchmark instrumentation.
+        LISTENER: string, RunListener that writes the structured result.
+        _fanout_results: dict, maps test class to the InstrumentationResult
+                         of its run over all instances and the number of
+                         instances it ran for.
+    """
+
+    HAL = "android.hardware.neuralnetworks@1.2::IDevice"
+    TEST_HAL_SERVICES = {HAL}
+    PACKAGE = "com.android.nn.benchmark.vts.v1_2"
+    LISTENER = "com.android.vts.hal.instrumentation.ResultFileListener"
+
+    def setUpClass(self):
+        """Initializes the results of fan-out runs."""
+        super(VtsHalNeuralnetworksV1_2Benchmark, self).setUpClass()
+        self._fanout_results = {}
+
+    def runFanOutBenchmark(self, test_class):
+        """Runs a benchmark class for all instances and checks the current one.
+
+        The instrumentation runs on the first call only; later instances
+        reuse its result.
+
+        Args:
+            test_class: string, simple name of the instrumentation test class.
+        """
+        if test_class not in self._fanout_results:
+            _, service_names = device_snapshot.GetHalServiceName(
+                self.dut, self.shell, self.HAL, self.abi_bitness)
+            instances = ",".join("%s/%s" % (self.HAL, name)
+                                 for name in sorted(service_names))
+            logging.info("Check logcat for more information")
+            self._fanout_results[test_class] = (
+                instrumentation_result.RunInstrumentation(
+                    self.shell,
+                    self.PACKAGE,
+                    self.LISTENER,
+                    test_class="%s.%s" % (self.PACKAGE, test_class),
+                    args={"halServiceInstances": instances}),
+                len(service_names))
+        result, instance_count = self._fanout_results[test_class]
+        asserts.assertTrue(result, "Benchmark did not report a result")
+
+        instance = self.cur_param[0][self.cur_param[0].rfind("/") + 1:]
+        sub_results = result.GetSubResults(instance)
+        if not sub_results.tests:
+            # With a single instance the tests report no sub-results. With
+            # several, an instance without any has not been benchmarked.
+            asserts.assertEqual(
+                1, instance_count,
+                "Benchmark did not report a result for %s" % instance)
+            sub_results = result
+        asserts.assertTrue(sub_results.tests, "Benchmark did not run any model")
+        logging.info("%s: %d passed, %d skipped", instance,
+                     len(sub_results.passed), len(sub_results.skipped))
+        asserts.assertEqual(
+            [], [test["name"] for test in sub_results.failed],
+            "Benchmark failed")
+        if instance_count > 1:
+            # A model that failed before reporting any sub-result, e.g. in
+            # setUp, cannot be attributed and fails every instance.
+            attributed = set(test["name"][:test["name"].rfind("@")]
+                             for test in result.tests if "@" in test["name"])
+            asserts.assertEqual(
+                [], [test["name"] for test in result.failed
+                     if "@" not in test["name"] and
+                     test["name"] not in attributed],
+                "Benchmark failed for all instances")
+
+    def runBenchmark(self, test_class, args=None):
+        """Runs a benchmark class for the current service instance.
+
+        Args:
+            test_class: string, simple name of the instrumentation test class.
+            args: dict, extra instrumentation arguments.
+
+        Returns:
+            InstrumentationResult object. Fails the test if no result was
+            written or if any model failed.
+        """
+        instrumentation_args = {"halServiceInstance": self.cur_param[0]}
+        instrumentation_args.update(args or {})
+        logging.info("Check logcat for more information")
+        result = instrumentation_result.RunInstrumentation(
+            self.shell,
+            self.PACKAGE,
+            self.LISTENER,
+            test_class="%s.%s" % (self.PACKAGE, test_class),
+            args=instrumentation_args)
+        asserts.assertTrue(result, "Benchmark did not report a result")
+        asserts.assertTrue(result.tests, "Benchmark did not run any model")
+        logging.info("%d passed, %d skipped", len(result.passed),
+                     len(result.skipped))
+        asserts.assertEqual(
+            [], [test["name"] for test in result.failed], "Benchmark failed")
+        return result
 
     def testAccuracy(self):
         """Test that the driver meets accuracy requirements."""
-        hal_service_instance = self.cur_param[0]
-        command = (
-            "am instrument -e halServiceInstance '{}' " +
-            "-w com.android.nn.benchmark.vts.v1_2/androidx.test.runner.AndroidJUnitRunner"
-        ).format(hal_service_instance)
-        logging.info("Executing command: %s", command)
-        logging.info("Check logcat for more information")
-        results = self.shell.Execute([command])
-        stdout = results[const.STDOUT][0]
-        stderr = results[const.STDERR][0]
-        exit_code = results[const.EXIT_CODE][0]
-        if stdout:
-          logging.info("stdout: %s", stdout)
-        if stderr:
-          logging.error("stderr: %s", stderr)
-        if exit_code:
-          logging.error("exit_code: %s", exit_code)
-        # The "am instrument" command exits with 0 even when there are failed tests.
-        asserts.assertTrue(re.search(r"^OK \([0-9]+ tests?\)$", stdout, re.M),
-                           "Benchmark failed")
+        if self.getUserParam("nn_instance_fanout", default_value=False):
+            self.runFanOutBenchmark("NNAccuracyTest")
+            return
+        self.runBenchmark("NNAccuracyTest")
+
+    def testPerformance(self):
+        """Measures compilation time, inference latency and throughput.
+
+        Runs only if the nn_benchmark_performance_repeat user param is larger
+        than 0. Each model runs its complete input set that many times.
+        """
+        repeat = int(self.getUserParam("nn_benchmark_performance_repeat",
+                                       default_value=0))
+        asserts.skipIf(repeat <= 0, "Performance benchmark is disabled")
+        result = self.runBenchmark("NNPerformanceTest", {"repeat": repeat})
+
+        # Test names look like Class#testDriverPerformance[model].
+        metrics = sorted((test["name"][test["name"].find("[") + 1:-1],
+                          test["metrics"]) for test in result.passed
+                         if test["metrics"])
+        for model, metric in metrics:
+            logging.info(
+                "%s: compile %.1f ms, latency p50 %.2f ms p99 %.2f ms, "
+                "%.1f inferences/s", model, metric["compile_ms"],
+                metric["latency_p50_ms"], metric["latency_p99_ms"],
+                metric["throughput_ips"])
+        if metrics and self.web.enabled:
+            device = self.cur_param[0][self.cur_param[0].rfind("/") + 1:]
+            labels = [model for model, _ in metrics]
+            for name, unit in (("compile_ms", "ms"), ("latency_p50_ms", "ms"),
+                               ("latency_p99_ms", "ms"),
+                               ("throughput_ips", "inferences/s")):
+                self.web.AddProfilingDataLabeledVector(
+                    "nn_%s_%s" % (device, name), labels,
+                    [int(metric[name]) for _, metric in metrics],
+                    x_axis_label="model",
+                    y_axis_label=unit)
 
 
 if __name__ == "__main__":
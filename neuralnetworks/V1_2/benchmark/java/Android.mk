@@ -31,7 +31,8 @@ LOCAL_MULTILIB := both
 LOCAL_COMPATIBILITY_SUITE := cts vts general-tests
 
 LOCAL_STATIC_JAVA_LIBRARIES := androidx.test.rules \
-    compatibility-device-util-axt ctstestrunner-axt junit NeuralNetworksApiBenchmark_Lib
+    compatibility-device-util-axt ctstestrunner-axt junit NeuralNetworksApiBenchmark_Lib \
+    VtsHalInstrumentationResultListener
 LOCAL_JNI_SHARED_LIBRARIES := libnnbenchmark_jni
 
 LOCAL_SRC_FILES := $(call all-java-files-under, src)
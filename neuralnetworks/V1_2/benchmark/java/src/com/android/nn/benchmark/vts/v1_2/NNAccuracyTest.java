@@ -30,10 +30,15 @@ import com.android.nn.benchmark.core.InferenceInOutSequence;
 import com.android.nn.benchmark.core.InferenceResult;
 import com.android.nn.benchmark.core.NNTestBase;
 import com.android.nn.benchmark.core.TestModels;
+import com.android.vts.hal.instrumentation.ResultFileListener;
 import java.io.IOException;
 import java.util.ArrayList;
 import java.util.Collections;
 import java.util.List;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
 import org.junit.AssumptionViolatedException;
 import org.junit.Before;
 import org.junit.Rule;
@@ -44,10 +49,15 @@ import org.junit.Test;
 
 /**
  * Tests the accuracy of the model outputs.
+ *
+ * With the {@code halServiceInstances} argument, a comma separated list of instances, each
+ * model runs on all of the drivers concurrently, and the verdict of every driver is reported
+ * through {@link ResultFileListener} as a sub-result named after the instance.
  */
 @RunWith(Parameterized.class)
 public class NNAccuracyTest {
     private static final String ARG_HAL_SERVICE_INSTANCE = "halServiceInstance";
+    private static final String ARG_HAL_SERVICE_INSTANCES = "halServiceInstances";
     private static final String HAL_SERVICE_INSTANCE_PREFIX =
             "android.hardware.neuralnetworks@1.2::IDevice/";
 
@@ -59,8 +69,7 @@ public class NNAccuracyTest {
 
     private Activity mActivity;
 
-    private String mHalServiceInstance;
-    private String mDeviceName;
+    private List<String> mDeviceNames = new ArrayList<>();
 
     // TODO(vddang): Add mobilenet_v1_0.25_128_quant_topk_aosp
     private static final String[] MODEL_NAMES = new String[] {
@@ -92,18 +101,22 @@ public class NNAccuracyTest {
     @Before
     public void setUp() throws Exception {
         mActivity = mActivityRule.getActivity();
-        mHalServiceInstance =
-                InstrumentationRegistry.getArguments().getString(ARG_HAL_SERVICE_INSTANCE);
-        assertTrue(mHalServiceInstance.startsWith(HAL_SERVICE_INSTANCE_PREFIX));
-        mDeviceName = mHalServiceInstance.substring(HAL_SERVICE_INSTANCE_PREFIX.length());
+        String instances =
+                InstrumentationRegistry.getArguments().getString(ARG_HAL_SERVICE_INSTANCES);
+        if (instances == null) {
+            instances = InstrumentationRegistry.getArguments().getString(ARG_HAL_SERVICE_INSTANCE);
+        }
+        for (String halServiceInstance : instances.split(",")) {
+            assertTrue(halServiceInstance.startsWith(HAL_SERVICE_INSTANCE_PREFIX));
+            mDeviceNames.add(halServiceInstance.substring(HAL_SERVICE_INSTANCE_PREFIX.length()));
+        }
     }
 
-    @Test
-    @LargeTest
-    public void testDriver() throws BenchmarkException, IOException {
+    /** Runs the model on a driver and returns whether the outputs are accurate. */
+    private boolean runOnDriver(String deviceName) throws BenchmarkException, IOException {
         NNTestBase test = mModel.createNNTestBase();
         test.useNNApi();
-        test.setNNApiDeviceName(mDeviceName);
+        test.setNNApiDeviceName(deviceName);
         if (!test.setupModel(mActivity)) {
             throw new AssumptionViolatedException("The driver rejected the model.");
         }
@@ -112,6 +125,41 @@ public class NNAccuracyTest {
         BenchmarkResult benchmarkResult = BenchmarkResult.fromInferenceResults(mModel.mModelName,
                 BenchmarkResult.BACKEND_TFLITE_NNAPI, inferenceResults.first,
                 inferenceResults.second, test.getEvaluator());
-        assertFalse(benchmarkResult.hasValidationErrors());
+        return !benchmarkResult.hasValidationErrors();
+    }
+
+    @Test
+    @LargeTest
+    public void testDriver() throws Exception {
+        if (mDeviceNames.size() == 1) {
+            assertTrue(runOnDriver(mDeviceNames.get(0)));
+            return;
+        }
+
+        ExecutorService executor = Executors.newFixedThreadPool(mDeviceNames.size());
+        try {
+            List<Future<Boolean>> futures = new ArrayList<>();
+            for (final String deviceName : mDeviceNames) {
+                futures.add(executor.submit(() -> runOnDriver(deviceName)));
+            }
+            boolean failed = false;
+            for (int i = 0; i < mDeviceNames.size(); i++) {
+                String deviceName = mDeviceNames.get(i);
+                try {
+                    boolean accurate = futures.get(i).get();
+                    ResultFileListener.addSubResult(deviceName, accurate ? "passed" : "failed",
+                            accurate ? null : "Validation errors");
+                    failed |= !accurate;
+                } catch (ExecutionException e) {
+                    boolean skipped = e.getCause() instanceof AssumptionViolatedException;
+                    ResultFileListener.addSubResult(deviceName, skipped ? "skipped" : "failed",
+                            String.valueOf(e.getCause()));
+                    failed |= !skipped;
+                }
+            }
+            assertFalse("Some drivers failed", failed);
+        } finally {
+            executor.shutdownNow();
+        }
     }
 }
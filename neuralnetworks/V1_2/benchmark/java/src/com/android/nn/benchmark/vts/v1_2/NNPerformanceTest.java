@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.nn.benchmark.vts.v1_2;
+
+import static junit.framework.TestCase.assertTrue;
+
+import android.app.Activity;
+import android.os.SystemClock;
+import android.util.Pair;
+import androidx.test.filters.LargeTest;
+import androidx.test.InstrumentationRegistry;
+import androidx.test.rule.ActivityTestRule;
+import com.android.nn.benchmark.core.BenchmarkException;
+import com.android.nn.benchmark.core.InferenceInOutSequence;
+import com.android.nn.benchmark.core.InferenceResult;
+import com.android.nn.benchmark.core.NNTestBase;
+import com.android.nn.benchmark.core.TestModels;
+import com.android.vts.hal.instrumentation.ResultFileListener;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.List;
+import org.junit.AssumptionViolatedException;
+import org.junit.Before;
+import org.junit.Rule;
+import org.junit.runner.RunWith;
+import org.junit.runners.Parameterized;
+import org.junit.runners.Parameterized.Parameters;
+import org.junit.Test;
+
+/**
+ * Measures the compilation time, inference latency and throughput of the models.
+ *
+ * The metrics of each model are reported through {@link ResultFileListener}.
+ */
+@RunWith(Parameterized.class)
+public class NNPerformanceTest {
+    private static final String ARG_HAL_SERVICE_INSTANCE = "halServiceInstance";
+    private static final String ARG_REPEAT = "repeat";
+    private static final String HAL_SERVICE_INSTANCE_PREFIX =
+            "android.hardware.neuralnetworks@1.2::IDevice/";
+
+    @Rule
+    public ActivityTestRule<NNAccuracyActivity> mActivityRule =
+            new ActivityTestRule<>(NNAccuracyActivity.class);
+
+    @Parameterized.Parameter(0) public TestModels.TestModelEntry mModel;
+
+    private Activity mActivity;
+
+    private String mDeviceName;
+    private int mRepeat;
+
+    @Parameters(name = "{0}")
+    public static List<TestModels.TestModelEntry> modelsList() {
+        return NNAccuracyTest.modelsList();
+    }
+
+    @Before
+    public void setUp() throws Exception {
+        mActivity = mActivityRule.getActivity();
+        String halServiceInstance =
+                InstrumentationRegistry.getArguments().getString(ARG_HAL_SERVICE_INSTANCE);
+        assertTrue(halServiceInstance.startsWith(HAL_SERVICE_INSTANCE_PREFIX));
+        mDeviceName = halServiceInstance.substring(HAL_SERVICE_INSTANCE_PREFIX.length());
+        mRepeat = Integer.parseInt(
+                InstrumentationRegistry.getArguments().getString(ARG_REPEAT, "10"));
+    }
+
+    /** Nearest-rank percentile, as computed by the host side scripts. */
+    private static float percentile(List<Float> sortedValues, int percent) {
+        int rank = (int) Math.ceil(percent / 100.0 * sortedValues.size());
+        return sortedValues.get(Math.max(rank - 1, 0));
+    }
+
+    @Test
+    @LargeTest
+    public void testDriverPerformance() throws BenchmarkException, IOException {
+        NNTestBase test = mModel.createNNTestBase();
+        test.useNNApi();
+        test.setNNApiDeviceName(mDeviceName);
+
+        try {
+            long compileStartNs = SystemClock.elapsedRealtimeNanos();
+            if (!test.setupModel(mActivity)) {
+                throw new AssumptionViolatedException("The driver rejected the model.");
+            }
+            long compileNs = SystemClock.elapsedRealtimeNanos() - compileStartNs;
+
+            // Warm up once so that lazy driver initialization is not measured.
+            test.runBenchmarkCompleteInputSet(/*setRepeat=*/1, /*timeoutSec=*/3600);
+
+            long runStartNs = SystemClock.elapsedRealtimeNanos();
+            Pair<List<InferenceInOutSequence>, List<InferenceResult>> inferenceResults =
+                    test.runBenchmarkCompleteInputSet(mRepeat, /*timeoutSec=*/3600);
+            long runNs = SystemClock.elapsedRealtimeNanos() - runStartNs;
+
+            List<Float> latenciesMs = new ArrayList<>();
+            for (InferenceResult result : inferenceResults.second) {
+                latenciesMs.add(result.mComputeTimeSec * 1000.0f);
+            }
+            assertTrue("No inference was run", !latenciesMs.isEmpty());
+            Collections.sort(latenciesMs);
+
+            ResultFileListener.addMetric("compile_ms", compileNs / 1e6);
+            ResultFileListener.addMetric("inferences", latenciesMs.size());
+            ResultFileListener.addMetric("latency_p50_ms", percentile(latenciesMs, 50));
+            ResultFileListener.addMetric("latency_p99_ms", percentile(latenciesMs, 99));
+            ResultFileListener.addMetric("throughput_ips", latenciesMs.size() / (runNs / 1e9));
+        } finally {
+            test.destroy();
+        }
+    }
+}
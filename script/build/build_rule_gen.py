@@ -19,6 +19,7 @@ import os
 import re
 
 from utils.const import Constant
+from utils import gen_manifest
 from vts_spec_parser import VtsSpecParser
 import build_rule_gen_utils as utils
 
@@ -46,6 +47,9 @@ class BuildRuleGen(object):
         self._vts_spec_parser = VtsSpecParser(package_root, path_root)
         self._package_root = package_root
         self._path_root = path_root
+        self._gen_manifest = gen_manifest.GenManifest(
+            gen_manifest.DefaultManifestPath(self._ANDROID_BUILD_TOP,
+                                             'build_rules'))
 
     def UpdateBuildRule(self, test_config_dir):
         """Updates build rules under the configuration directory.
@@ -64,13 +68,16 @@ class BuildRuleGen(object):
         updated |= utils.RemoveFilesInDirIf(
             os.path.join(self._ANDROID_BUILD_TOP, test_config_dir),
             lambda x: self._IsAutoGenerated(x) and (x not in gen_file_paths))
+        self._gen_manifest.Save()
         return updated_file_paths, updated
 
     def UpdateHalDirBuildRule(self, hal_list, test_config_dir):
         """Updates build rules for vts drivers/profilers.
 
         Updates vts drivers/profilers for each pair of (hal_name, hal_version)
-        in hal_list.
+        in hal_list. A build file is only re-rendered if its template, its
+        .hal sources or the generator options changed since it was last
+        generated.
 
         Args:
             hal_list: list of tuple of strings. For example,
@@ -87,6 +94,8 @@ class BuildRuleGen(object):
         checked_file_paths = []
         updated_file_paths = []
         ever_updated = False
+        with open(self._VTS_BUILD_TEMPLATE) as template_file:
+            build_template = str(template_file.read())
         for target in hal_list:
             hal_name = target[0]
             hal_version = target[1]
@@ -96,32 +105,24 @@ class BuildRuleGen(object):
                 utils.HalNameDir(hal_name), utils.HalVerDir(hal_version))
 
             file_path = os.path.join(hal_dir, 'build', 'Android.bp')
-            updated = utils.WriteBuildRule(file_path, self._VtsBuildRuleFromTemplate(
-                self._VTS_BUILD_TEMPLATE, hal_name, hal_version))
             checked_file_paths.append(file_path)
+            inputs_hash = gen_manifest.HashInputs(
+                build_template, self._warning_header, self._package_root,
+                self._path_root, hal_name, hal_version,
+                gen_manifest.HashHalSources(self._ANDROID_BUILD_TOP,
+                                            self._path_root, hal_name,
+                                            hal_version))
+            if self._gen_manifest.IsUpToDate(file_path, inputs_hash):
+                continue
+            build_rule = self._FillOutBuildRuleTemplate(
+                hal_name, hal_version, build_template)
+            updated = utils.WriteBuildRule(file_path, build_rule)
+            self._gen_manifest.Record(file_path, inputs_hash, build_rule)
             if updated:
                 updated_file_paths.append(file_path)
                 ever_updated = True
         return checked_file_paths, updated_file_paths, ever_updated
 
-    def _VtsBuildRuleFromTemplate(self, template_path, hal_name, hal_version):
-        """Returns build rules in string form by filling out a template.
-
-        Reads template from given path and fills it out.
-
-        Args:
-          template_path: string, path to build rule template file.
-          hal_name: string, name of the hal, e.g. 'vibrator'.
-          hal_version: string, version of the hal, e.g '7.4'
-
-        Returns:
-          string, complete build rules in string form
-        """
-        with open(template_path) as template_file:
-            build_template = str(template_file.read())
-        return self._FillOutBuildRuleTemplate(hal_name, hal_version,
-                                              build_template)
-
     def _FillOutBuildRuleTemplate(self, hal_name, hal_version, template):
         """Returns build rules in string form by filling out given template.
 
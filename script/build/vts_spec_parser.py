@@ -21,6 +21,7 @@ import shutil
 import subprocess
 import sys
 import tempfile
+import threading
 
 from utils.const import Constant
 
@@ -51,7 +52,12 @@ class VtsSpecParser(object):
         Args:
             tmp_dir: string, temporary directory to which to write .vts files.
         """
-        self._cache = set()
+        # Maps (hal name, hal version) to a threading.Event that is set once
+        # hidl-gen finished generating the .vts files, so that concurrent
+        # callers share one hidl-gen run per package.
+        self._cache = {}
+        self._cache_lock = threading.Lock()
+        self._proto_cache = {}
         self._tmp_dir = tempfile.mkdtemp()
         self._package_root = package_root
         self._path_root = path_root
@@ -93,6 +99,70 @@ class VtsSpecParser(object):
 
         return sorted(list(set(imported_packages) - set(exclude_packages)))
 
+    def ReachableVtsSpecs(self, hal_name, hal_version):
+        """Returns the .vts specs reachable from the interfaces of a hal.
+
+        Starts from every spec of the given package and follows the
+        'import' entries of the specs transitively. An import such as
+        'android.hardware.graphics.common@1.0::types' only reaches the
+        corresponding spec (types.vts) of the imported package, not all of
+        its specs.
+
+        Imported packages outside the package root, e.g.
+        android.hidl.safe_union@1.0, are not generated by this parser. They
+        are returned with no specs, so that their drivers are still pushed.
+
+        Args:
+          hal_name: string, name of the hal, e.g. 'vibrator'.
+          hal_version: string, version of the hal, e.g '7.4'
+
+        Returns:
+          dict, maps package names to sorted lists of .vts file names. For
+          example,
+              {'android.hardware.vibrator@1.3': ['Vibrator.vts', 'types.vts'],
+               'android.hardware.foo@1.0': ['types.vts'],
+               'android.hidl.safe_union@1.0': []}
+        """
+        exclude_packages = [
+            "android.hidl.base@1.0", "android.hidl.manager@1.0",
+        ]
+        root_package = '%s.%s@%s' % (self._package_root, hal_name, hal_version)
+        reachable = {}
+        pending = [(root_package, vts_spec)
+                   for vts_spec in self.VtsSpecNames(hal_name, hal_version)]
+        while pending:
+            package, vts_spec = pending.pop()
+            if vts_spec in reachable.setdefault(package, set()):
+                continue
+            reachable[package].add(vts_spec)
+
+            package_str, package_version = package.split('@')
+            package_name = package_str[len(self._package_root) + 1:]
+            vts_spec_names = self.VtsSpecNames(package_name, package_version)
+            spec_proto = self.VtsSpecProtos(
+                package_name, package_version)[vts_spec_names.index(vts_spec)]
+            for imported in getattr(spec_proto, 'import', []):
+                imported_package, _, component = imported.partition('::')
+                if imported_package in exclude_packages:
+                    continue
+                if not imported_package.startswith(self._package_root + '.'):
+                    reachable.setdefault(imported_package, set())
+                    continue
+                imported_str, imported_version = imported_package.split('@')
+                imported_name = imported_str[len(self._package_root) + 1:]
+                imported_specs = self.VtsSpecNames(imported_name,
+                                                   imported_version)
+                imported_spec = VtsSpecFileName(component)
+                if imported_spec in imported_specs:
+                    pending.append((imported_package, imported_spec))
+                else:
+                    # Unknown component, conservatively reach the whole
+                    # package.
+                    pending.extend((imported_package, spec)
+                                   for spec in imported_specs)
+        return dict((package, sorted(vts_specs))
+                    for package, vts_specs in reachable.iteritems())
+
     def GenerateVtsSpecs(self, hal_name, hal_version):
         """Generates VTS specs.
 
@@ -103,7 +173,16 @@ class VtsSpecParser(object):
           hal_version: string, version of the hal, e.g '7.4'
           tmp_dir: string, location to which to write tmp files.
         """
-        if (hal_name, hal_version) in self._cache:
+        with self._cache_lock:
+            generated = self._cache.get((hal_name, hal_version))
+            if generated is None:
+                generated = threading.Event()
+                self._cache[(hal_name, hal_version)] = generated
+                owner = True
+            else:
+                owner = False
+        if not owner:
+            generated.wait()
             return
         hidl_gen_cmd = (
             'hidl-gen -o {TEMP_DIR} -L vts -r {PACKAGE_ROOT}:{PATH_ROOT} '
@@ -113,8 +192,10 @@ class VtsSpecParser(object):
                 PATH_ROOT=self._path_root,
                 HAL_NAME=hal_name,
                 HAL_VERSION=hal_version)
-        subprocess.call(hidl_gen_cmd, shell=True)
-        self._cache.add((hal_name, hal_version))
+        try:
+            subprocess.call(hidl_gen_cmd, shell=True)
+        finally:
+            generated.set()
 
     def HalNamesAndVersions(self):
         """Returns a list of hals and versions under hal interface directory.
@@ -168,8 +249,12 @@ class VtsSpecParser(object):
         hal_version: string, version of the hal, e.g '7.4'
 
         Returns:
-          list of ComponentSpecificationMessages
+          list of ComponentSpecificationMessages. The list is cached and
+          shared by all callers, callers must not modify it.
         """
+        with self._cache_lock:
+            if (hal_name, hal_version) in self._proto_cache:
+                return self._proto_cache[(hal_name, hal_version)]
         self.GenerateVtsSpecs(hal_name, hal_version)
         vts_spec_dir = os.path.join(self._tmp_dir,
                                     self._package_root.replace('.', '/'),
@@ -183,4 +268,22 @@ class VtsSpecParser(object):
                 text_format.Merge(spec_string, spec_proto)
 
             vts_spec_protos.append(spec_proto)
+        with self._cache_lock:
+            self._proto_cache[(hal_name, hal_version)] = vts_spec_protos
         return vts_spec_protos
+
+
+def VtsSpecFileName(component):
+    """Returns the .vts file name of a component imported by a spec.
+
+    Args:
+      component: string, component part of an import, e.g. 'types',
+                 'IVibrator' or 'IVibrator.Effect'.
+
+    Returns:
+      string, e.g. 'types.vts' or 'Vibrator.vts'.
+    """
+    top_level = component.split('.')[0]
+    if top_level.startswith('I') and top_level[1:2].isupper():
+        top_level = top_level[1:]
+    return top_level + '.vts'
@@ -0,0 +1,110 @@
+#!/usr/bin/env python
+#
+# Copyright 2019 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+import argparse
+import os
+import subprocess
+import sys
+
+from configure.test_config import FindTestConfigs
+from utils import gtest_list
+from utils.const import Constant
+"""Save the test case lists of the target test binaries of a build.
+
+Every target test binary built in ANDROID_PRODUCT_OUT is pushed to a device
+and run with --gtest_list_tests, and the output is saved in the list
+directory. The lists only change with the test sources, so this runs once
+after a build. update_hal_tests.py then emits gtest-batch-mode and a shard
+count for the modules of the listed binaries.
+
+Usage:
+  python capture_gtest_lists.py [--serial SERIAL] [--list_dir DIR]
+"""
+
+DEVICE_TMP_DIR = '/data/local/tmp'
+
+
+def Adb(serial, *args):
+    """Runs an adb command and returns its stdout."""
+    cmd = ['adb']
+    if serial:
+        cmd += ['-s', serial]
+    return subprocess.check_output(cmd + list(args))
+
+
+def CaptureGtestList(serial, binary_path):
+    """Returns the --gtest_list_tests output of a binary.
+
+    Args:
+      serial: string, serial of the device, None for the default device.
+      binary_path: string, path of the binary on the host.
+    """
+    device_path = '%s/%s' % (DEVICE_TMP_DIR, os.path.basename(binary_path))
+    Adb(serial, 'push', binary_path, device_path)
+    try:
+        return Adb(serial, 'shell', '%s --gtest_list_tests' % device_path)
+    finally:
+        Adb(serial, 'shell', 'rm -f %s' % device_path)
+
+
+def main():
+    build_top = os.getenv('ANDROID_BUILD_TOP')
+    product_out = os.getenv('ANDROID_PRODUCT_OUT')
+    if not build_top or not product_out:
+        print('Error: Missing ANDROID_BUILD_TOP env variable. Please run '
+              '\'. build/envsetup.sh; lunch <build target>\' Exiting...')
+        sys.exit(1)
+
+    parser = argparse.ArgumentParser(
+        description='Save the test case lists of the target test binaries.')
+    parser.add_argument(
+        '--serial', dest='serial', required=False, help='Device serial.')
+    parser.add_argument(
+        '--list_dir',
+        dest='list_dir',
+        required=False,
+        default=gtest_list.DefaultListDir(build_top),
+        help='Directory to save the test case lists in.')
+    args = parser.parse_args()
+
+    if not os.path.exists(args.list_dir):
+        os.makedirs(args.list_dir)
+
+    test_binaries = set()
+    for test_config in FindTestConfigs(
+            os.path.join(build_top, Constant.VTS_HAL_TEST_CASE_PATH)):
+        if test_config.test_binary:
+            test_binaries.add(test_config.test_binary)
+
+    abi = Adb(args.serial, 'shell', 'getprop ro.product.cpu.abi').strip()
+    native_test_dir = 'nativetest64' if '64' in abi else 'nativetest'
+    for test_binary in sorted(test_binaries):
+        binary_path = os.path.join(product_out, 'data', native_test_dir,
+                                   test_binary, test_binary)
+        if not os.path.isfile(binary_path):
+            print 'WARNING: %s is not built, skipping.' % test_binary
+            continue
+        content = CaptureGtestList(args.serial, binary_path)
+        with open(gtest_list.ListPath(args.list_dir, test_binary),
+                  'w') as list_file:
+            list_file.write(content)
+        print '%s: %d case(s)' % (test_binary,
+                                  len(gtest_list.ParseGtestList(content)))
+
+
+if __name__ == '__main__':
+    main()
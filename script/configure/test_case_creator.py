@@ -20,7 +20,10 @@
 # test/vts-testcases/hal/ based on the hal package name.
 
 import datetime
+import difflib
+import math
 import os
+import re
 import sys
 
 from build.vts_spec_parser import VtsSpecParser
@@ -28,6 +31,9 @@ from xml.dom import minidom
 from xml.etree import cElementTree as ET
 from xml.sax.saxutils import unescape
 from utils.const import Constant
+from utils import gen_manifest
+from utils import gtest_list
+from utils import run_history
 
 ANDROID_BP_FILE_NAME = 'Android.bp'
 ANDROID_TEST_XML_FILE_NAME = 'AndroidTest.xml'
@@ -51,13 +57,29 @@ class TestCaseCreator(object):
         test_plan: string, the plan that the test belongs to.
         test_dir: string, test case absolute directory.
         time_out: string, timeout of the test, default is 1m.
+        runtime_hint: string, expected duration of the test, None to omit.
         stop_runtime: boolean whether to stop framework before the test.
+        scheduling_group: string, scheduling group of the module, None if it
+                          has none.
+        abi_bitness: list of strings, bitness of the vts drivers to push.
+        bundled_pushes: list of push entries provided by the push bundle of
+                        the plan of the test.
+        pushes: list of all push entries generated for the test, including
+                the bundled ones.
+        gtest_cases: list of strings, test cases of the target test binary,
+                     None if its case list was not saved.
+        gtest_batch_mode: boolean, whether to run the gtest cases in batches.
         build_top: string, equal to environment variable ANDROID_BUILD_TOP.
         vts_spec_parser: tools that generates and parses vts spec with hidl-gen.
         current_year: current year.
+        dry_run: boolean, whether to only compute the changes without writing.
+        gen_manifest: GenManifest used to skip regenerating files whose
+                      inputs did not change, None to always regenerate.
+        changes: list of (path, diff) tuples of the files changed (or to be
+                 changed in dry run mode) by this creator.
     """
 
-    def __init__(self, vts_spec_parser, hal_package_name):
+    def __init__(self, vts_spec_parser, hal_package_name, gen_manifest=None):
         '''Initialize class attributes.'''
         self._hal_package_name = hal_package_name
 
@@ -70,12 +92,17 @@ class TestCaseCreator(object):
         self._vts_spec_parser = vts_spec_parser
 
         self._current_year = datetime.datetime.now().year
+        self._dry_run = False
+        self._changes = []
+        self._gen_manifest = gen_manifest
+        self._imported_packages = []
 
     def LaunchTestCase(self,
                        test_type,
                        time_out='1m',
                        is_replay=False,
                        stop_runtime=False,
+                       scheduling_group=None,
                        update_only=False,
                        mapping_dir_path="",
                        test_binary_file=None,
@@ -83,24 +110,68 @@ class TestCaseCreator(object):
                        test_config_dir=Constant.VTS_HAL_TEST_CASE_PATH,
                        package_root=Constant.HAL_PACKAGE_PREFIX,
                        path_root=Constant.HAL_INTERFACE_PATH,
-                       is_profiling=False):
+                       is_profiling=False,
+                       dry_run=False,
+                       abi_bitness=None,
+                       bundled_pushes=None,
+                       runtime_hint=None,
+                       run_history=None,
+                       gtest_list_dir=None,
+                       gtest_batch_mode=False):
         """Create the necessary configuration files to launch a test case.
 
         Args:
           test_type: type of the test.
           time_out: timeout of the test.
+          is_replay: whether the test replays the HAL traces.
           stop_runtime: whether to stop framework before the test.
+          scheduling_group: scheduling group of the module, e.g. the group
+                            of an existing configure. None to put target
+                            tests that stop the framework in the
+                            framework-stopped group.
           update_only: flag to only update existing test configure.
           mapping_dir_path: directory that stores the cts_hal_mapping files.
                             Used for adapter test only.
+          is_profiling: whether the test runs with HAL profiling enabled and
+                        collects the profiling traces of the HAL calls.
+          dry_run: flag to only record the changes without writing files.
+          abi_bitness: list of strings, bitness ('32', '64') of the device
+                       ABIs to push vts drivers for. None to push the
+                       drivers of all ABIs.
+          bundled_pushes: dict, maps plan names to the sets of push entries
+                          installed once per plan by push_bundle.py. The
+                          entries of the plan of the test are omitted from
+                          the configure.
+          runtime_hint: string, expected duration of the test used by the
+                        schedulers of tradefed, None to omit it.
+          run_history: RunHistory of the past runs. If it has enough runs of
+                       the test module, the test-timeout and runtime-hint
+                       derived from them replace time_out and runtime_hint.
+          gtest_list_dir: directory of the test case lists saved by
+                          capture_gtest_lists.py, None for the default one.
+                          Target tests whose binary has a saved list run in
+                          batch mode and are sharded by their runtime hint.
+          gtest_batch_mode: whether to run the gtest cases in batches even
+                            without a saved case list.
 
         Returns:
           boolean, whether created/updated a test case successfully.
         """
         self._test_type = test_type
+        self._dry_run = dry_run
+        self._abi_bitness = sorted(abi_bitness or ALL_ABI_BITNESS)
+        self._pushes = []
+        self._imported_packages = []
         self._time_out = time_out
+        self._runtime_hint = runtime_hint
+        self._gtest_cases = None
+        self._gtest_batch_mode = gtest_batch_mode
         self._is_replay = is_replay
+        self._is_profiling = is_profiling
         self._stop_runtime = stop_runtime
+        self._scheduling_group = scheduling_group
+        if not scheduling_group and stop_runtime and test_type == 'target':
+            self._scheduling_group = Constant.FRAMEWORK_STOPPED_GROUP
         self._mapping_dir_path = mapping_dir_path
         self._test_binary_file = test_binary_file
         self._test_script_file = test_script_file
@@ -117,9 +188,19 @@ class TestCaseCreator(object):
         self._test_plan = 'vts-staging-default'
         if is_replay:
             self._test_name = self._test_module_name + 'Replay'
-            self._test_plan = 'vts-hal-replay'
+            # Profiling replays start in staging, like other new modules.
+            if not is_profiling:
+                self._test_plan = 'vts-hal-replay'
+        if is_profiling:
+            self._test_name = self._test_name + 'Profiling'
         if self._test_type == 'adapter':
             self._test_plan = 'vts-hal-adapter'
+        self._bundled_pushes = sorted((bundled_pushes or {}).get(
+            self._test_plan, []))
+        if run_history:
+            suggestion = run_history.Suggest(self._test_name)
+            if suggestion:
+                self._time_out, self._runtime_hint = suggestion
 
         self._test_dir = self.GetHalTestCasePath()
         # Check whether the host side test script and target test binary is available.
@@ -139,9 +220,17 @@ class TestCaseCreator(object):
                           test_binary_file)
                     return False
                 self._test_binary_file = os.path.basename(test_binary_file)
+            if not self._is_replay:
+                self._gtest_cases = gtest_list.ReadGtestList(
+                    gtest_list_dir or gtest_list.DefaultListDir(
+                        self._build_top),
+                    self._test_binary_file[:-len('.cpp')])
 
         if os.path.exists(self._test_dir):
             print 'WARNING: Test directory already exists. Continuing...'
+        elif dry_run:
+            print('WARNING: Test directory does not exist, skip in dry run.')
+            return True
         elif not update_only:
             try:
                 os.makedirs(self._test_dir)
@@ -150,7 +239,7 @@ class TestCaseCreator(object):
                       'Exiting...' % self._test_dir)
                 return False
         else:
-            print('WARNING: Test directory does not exists, stop updating.')
+            print('WARNING: Test directory does not exist, stop updating.')
             return True
 
         self.CreateAndroidBp()
@@ -202,6 +291,8 @@ class TestCaseCreator(object):
         test_dir = self._test_type
         if self._is_replay:
             test_dir = test_dir + '_replay'
+        if self._is_profiling:
+            test_dir = test_dir + '_profiling'
         return os.path.join(self._build_top, self._test_config_dir,
                             self.GetHalPath(), self.GetHalVersionToken(),
                             test_dir)
@@ -214,15 +305,26 @@ class TestCaseCreator(object):
     def CreateAndroidBp(self):
         """Create Android.bp."""
         target = os.path.join(self._test_dir, ANDROID_BP_FILE_NAME)
-        with open(target, 'w') as f:
-            print 'Creating %s' % target
-            f.write(ANDROID_BP_TEMPLATE.format(test_name=self._test_name, year=self._current_year))
+        inputs_hash = self.GetInputsHash(target, ANDROID_BP_TEMPLATE)
+        if self.IsUpToDate(target, inputs_hash):
+            return
+        existing_content = self.ReadExistingFile(target)
+        self.WriteFile(target, existing_content,
+                       ANDROID_BP_TEMPLATE.format(
+                           test_name=self._test_name,
+                           year=self.GetCopyrightYear(existing_content)),
+                       inputs_hash)
 
     def CreateAndroidTestXml(self):
         """Create AndroidTest.xml."""
         VTS_FILE_PUSHER = 'com.android.compatibility.common.tradefed.targetprep.VtsFilePusher'
         VTS_TEST_CLASS = 'com.android.tradefed.testtype.VtsMultiDeviceTest'
 
+        target = os.path.join(self._test_dir, ANDROID_TEST_XML_FILE_NAME)
+        inputs_hash = self.GetInputsHash(target, LICENSE_STATEMENT_XML)
+        if self.IsUpToDate(target, inputs_hash):
+            return
+
         configuration = ET.Element('configuration', {
             'description':
             'Config for VTS ' + self._test_name + ' test cases'
@@ -234,6 +336,24 @@ class TestCaseCreator(object):
                 'key': 'plan',
                 'value': self._test_plan
             })
+        # Lets plan_scheduler.py run the module inside one framework stop
+        # window with the other modules that stop the framework.
+        if self._scheduling_group:
+            ET.SubElement(
+                configuration, 'option', {
+                    'name': 'config-descriptor:metadata',
+                    'key': Constant.SCHEDULING_GROUP_KEY,
+                    'value': self._scheduling_group
+                })
+        # Lets device_scheduler.py split the cases of a long module.
+        shard_count = self.GetGtestShardCount()
+        if shard_count > 1:
+            ET.SubElement(
+                configuration, 'option', {
+                    'name': 'config-descriptor:metadata',
+                    'key': Constant.SHARD_COUNT_KEY,
+                    'value': str(shard_count)
+                })
 
         if self._test_type == 'adapter':
             self.CreateAndroidTestXmlForAdapterTest(configuration)
@@ -242,17 +362,150 @@ class TestCaseCreator(object):
                                         {'class': VTS_FILE_PUSHER})
 
             self.GeneratePushFileConfigure(file_pusher)
+            # Lets the schedulers install the push bundle before the module
+            # runs, since the configure no longer pushes these files.
+            if set(self._pushes) & set(self._bundled_pushes):
+                configuration.insert(
+                    1,
+                    ET.Element(
+                        'option', {
+                            'name': 'config-descriptor:metadata',
+                            'key': Constant.PUSH_BUNDLE_KEY,
+                            'value': self._test_plan
+                        }))
             test = ET.SubElement(configuration, 'test',
                                  {'class': VTS_TEST_CLASS})
 
             self.GenerateTestOptionConfigure(test)
 
-        target = os.path.join(self._test_dir, ANDROID_TEST_XML_FILE_NAME)
+        existing_content = self.ReadExistingFile(target)
+        content = (XML_HEADER + LICENSE_STATEMENT_XML.format(
+            year=self.GetCopyrightYear(existing_content)) +
+                   self.Prettify(configuration))
+        self.WriteFile(target, existing_content, content, inputs_hash)
+
+    def GetInputsHash(self, target, template):
+        """Computes the hash of everything a generated file depends on.
+
+        Besides the options of this test case and the .hal sources of the
+        package, the hash covers the .hal sources of the packages that the
+        previous generation of the file imported, so that a change in an
+        imported package invalidates the pushed spec list.
+
+        Args:
+          target: string, path of the generated file.
+          template: string, template the file is rendered from.
+
+        Returns:
+          string, hex digest, None if no manifest is used.
+        """
+        if not self._gen_manifest:
+            return None
+        inputs = [
+            template, self._hal_package_name, self._test_type,
+            self._test_name, self._test_plan, self._time_out,
+            self._runtime_hint, self._is_replay, self._is_profiling,
+            self._stop_runtime,
+            self._scheduling_group, self._test_binary_file,
+            self._test_script_file, self._package_root, self._path_root,
+            self._abi_bitness, self._bundled_pushes, self._gtest_cases,
+            self._gtest_batch_mode,
+            gen_manifest.HashHalSources(self._build_top, self._path_root,
+                                        self._hal_name, self._hal_version)
+        ]
+        for package in self._gen_manifest.GetDeps(target):
+            inputs.append((package, self.HashPackageSources(package)))
+        if self._is_replay:
+            inputs.append(sorted(self.GetVtsHalReplayTraceFiles()))
+        if self._test_type == 'adapter':
+            with open(self.GetLatestMappingFile(), 'r') as mapping_file:
+                inputs.append(gen_manifest.HashContent(mapping_file.read()))
+        return gen_manifest.HashInputs(*inputs)
+
+    def HashPackageSources(self, package):
+        """Hashes the .hal sources of a package, e.g. android.hardware.foo@1.0."""
+        package_str, package_version = package.split('@')
+        if not package_str.startswith(self._package_root + '.'):
+            return ''
+        return gen_manifest.HashHalSources(
+            self._build_top, self._path_root,
+            package_str[len(self._package_root) + 1:], package_version)
+
+    def IsUpToDate(self, target, inputs_hash):
+        """Checks whether a generated file can be left untouched.
+
+        Args:
+          target: string, path of the generated file.
+          inputs_hash: string, current hash of its inputs, or None.
+
+        Returns:
+          True iff the file was generated from the same inputs and was not
+          modified since.
+        """
+        return bool(inputs_hash) and self._gen_manifest.IsUpToDate(
+            target, inputs_hash)
+
+    def ReadExistingFile(self, target):
+        """Reads a previously generated file.
+
+        Args:
+          target: string, path of the file.
+
+        Returns:
+          string, content of the file, None if the file does not exist.
+        """
+        if not os.path.isfile(target):
+            return None
+        with open(target, 'r') as f:
+            return f.read()
+
+    def GetCopyrightYear(self, existing_content):
+        """Gets the copyright year to use for a generated file.
+
+        Keeps the year of an existing file so that regenerating a configure
+        is deterministic and does not touch files whose content is unchanged.
+
+        Args:
+          existing_content: string, content of the existing file or None.
+
+        Returns:
+          int, the copyright year.
+        """
+        if existing_content:
+            match = re.search(Constant.COPYRIGHT_YEAR_PATTERN, existing_content)
+            if match:
+                return int(match.group(1))
+        return self._current_year
+
+    def WriteFile(self, target, existing_content, content, inputs_hash=None):
+        """Writes a generated file if its content changed.
+
+        In dry run mode, only records the diff against the existing file.
+
+        Args:
+          target: string, path of the file.
+          existing_content: string, content of the existing file or None.
+          content: string, the generated content.
+          inputs_hash: string, hash of the inputs to record in the manifest.
+        """
+        if inputs_hash and not self._dry_run:
+            self._gen_manifest.Record(target, inputs_hash, content,
+                                      self._imported_packages, self._pushes)
+        if existing_content == content:
+            return
+        diff = ''.join(
+            difflib.unified_diff((existing_content or '').splitlines(True),
+                                 content.splitlines(True), target, target))
+        self._changes.append((target, diff))
+        if self._dry_run:
+            return
         with open(target, 'w') as f:
             print 'Creating %s' % target
-            f.write(XML_HEADER)
-            f.write(LICENSE_STATEMENT_XML.format(year=self._current_year))
-            f.write(self.Prettify(configuration))
+            f.write(content)
+
+    def GetChanges(self):
+        """Returns the list of (path, diff) tuples of the changed files."""
+        return list(self._changes)
 
     def CreateAndroidTestXmlForAdapterTest(self, configuration):
         """Create the test configuration within AndroidTest.xml for adapter test.
@@ -299,16 +552,7 @@ class TestCaseCreator(object):
             })
 
         # Configure CTS tests.
-        list_of_files = os.listdir(self._mapping_dir_path)
-        # Use the latest mapping file.
-        latest_file = max(
-            [
-                os.path.join(self._mapping_dir_path, basename)
-                for basename in list_of_files
-            ],
-            key=os.path.getctime)
-
-        with open(latest_file, 'r') as cts_hal_map_file:
+        with open(self.GetLatestMappingFile(), 'r') as cts_hal_map_file:
             for line in cts_hal_map_file.readlines():
                 if line.startswith(Constant.HAL_PACKAGE_PREFIX + '.' +
                                    self._hal_name + '@' + adapter_version):
@@ -319,6 +563,16 @@ class TestCaseCreator(object):
                         ET.SubElement(configuration, 'include',
                                       {'name': test_config_name})
 
+    def GetLatestMappingFile(self):
+        """Get the latest cts_hal_mapping file for adapter test."""
+        list_of_files = os.listdir(self._mapping_dir_path)
+        return max(
+            [
+                os.path.join(self._mapping_dir_path, basename)
+                for basename in list_of_files
+            ],
+            key=os.path.getctime)
+
     def GeneratePushFileConfigure(self, file_pusher):
         """Create the push file configuration within AndroidTest.xml
 
@@ -347,46 +601,69 @@ class TestCaseCreator(object):
                 'value': 'HalHidlHostTest.push'
             })
 
-        imported_package_lists = self._vts_spec_parser.ImportedPackagesList(
-            self._hal_name, self._hal_version)
-        imported_package_lists.append(self._hal_package_name)
         # Generate additional push files e.g driver/profiler/vts_spec
         if self._test_type == 'host' or self._is_replay:
             ET.SubElement(file_pusher, 'option', {
                 'name': 'cleanup',
                 'value': 'true'
             })
+            # Only push the specs reachable from the tested interfaces and the
+            # drivers of the packages that own them.
+            reachable_specs = self._vts_spec_parser.ReachableVtsSpecs(
+                self._hal_name, self._hal_version)
+            imported_package_lists = sorted(
+                package for package in reachable_specs
+                if package != self._hal_package_name)
+            self._imported_packages = list(imported_package_lists)
+            imported_package_lists.append(self._hal_package_name)
             for imported_package in imported_package_lists:
                 imported_package_str, imported_package_version = imported_package.split(
                     '@')
                 imported_package_name = imported_package_str[
                     len(self._package_root) + 1:]
-                imported_vts_spec_lists = self._vts_spec_parser.VtsSpecNames(
-                    imported_package_name, imported_package_version)
-                for vts_spec in imported_vts_spec_lists:
+                for vts_spec in reachable_specs.get(imported_package, []):
                     push_spec = VTS_SPEC_PUSH_TEMPLATE.format(
                         hal_path=imported_package_name.replace('.', '/'),
                         hal_version=imported_package_version,
                         package_path=imported_package_str.replace('.', '/'),
                         vts_file=vts_spec)
-                    ET.SubElement(file_pusher, 'option', {
-                        'name': 'push',
-                        'value': push_spec
-                    })
+                    self.AddPush(file_pusher, push_spec)
 
                 dirver_package_name = imported_package + '-vts.driver.so'
-                push_driver = VTS_LIB_PUSH_TEMPLATE_32.format(
-                    lib_name=dirver_package_name)
-                ET.SubElement(file_pusher, 'option', {
-                    'name': 'push',
-                    'value': push_driver
-                })
-                push_driver = VTS_LIB_PUSH_TEMPLATE_64.format(
-                    lib_name=dirver_package_name)
-                ET.SubElement(file_pusher, 'option', {
-                    'name': 'push',
-                    'value': push_driver
-                })
+                if '32' in self._abi_bitness:
+                    push_driver = VTS_LIB_PUSH_TEMPLATE_32.format(
+                        lib_name=dirver_package_name)
+                    self.AddPush(file_pusher, push_driver)
+                if '64' in self._abi_bitness:
+                    push_driver = VTS_LIB_PUSH_TEMPLATE_64.format(
+                        lib_name=dirver_package_name)
+                    self.AddPush(file_pusher, push_driver)
+
+                if not self._is_profiling:
+                    continue
+                profiler_package_name = imported_package + '-vts.profiler.so'
+                if '32' in self._abi_bitness:
+                    self.AddPush(
+                        file_pusher,
+                        VTS_LIB_PUSH_TEMPLATE_32.format(
+                            lib_name=profiler_package_name))
+                if '64' in self._abi_bitness:
+                    self.AddPush(
+                        file_pusher,
+                        VTS_LIB_PUSH_TEMPLATE_64.format(
+                            lib_name=profiler_package_name))
+
+    def AddPush(self, file_pusher, push):
+        """Adds a push option unless the file comes from the plan push bundle.
+
+        Args:
+          file_pusher: parent xml element for push file configure.
+          push: string, push entry in the form of source->destination.
+        """
+        self._pushes.append(push)
+        if push in self._bundled_pushes:
+            return
+        ET.SubElement(file_pusher, 'option', {'name': 'push', 'value': push})
 
     def GenerateTestOptionConfigure(self, test):
         """Create the test option configuration within AndroidTest.xml
@@ -457,10 +734,45 @@ class TestCaseCreator(object):
                 'value': test_script_file
             })
 
+        if self._is_profiling:
+            ET.SubElement(test, 'option', {
+                'name': 'enable-profiling',
+                'value': 'true'
+            })
         ET.SubElement(test, 'option', {
             'name': 'test-timeout',
             'value': self._time_out
         })
+        if self._runtime_hint:
+            ET.SubElement(test, 'option', {
+                'name': 'runtime-hint',
+                'value': self._runtime_hint
+            })
+        # One gtest process runs a batch of cases, so that the process start
+        # and the HAL service lookup are paid per batch instead of per case.
+        if self._test_type == 'target' and (
+                self._gtest_batch_mode or
+                len(self._gtest_cases or []) >= MIN_GTEST_BATCH_CASES):
+            ET.SubElement(test, 'option', {
+                'name': 'gtest-batch-mode',
+                'value': 'true'
+            })
+
+    def GetGtestShardCount(self):
+        """Returns the number of shards to split the gtest cases into.
+
+        The runtime hint is split into shards of about GTEST_SHARD_RUNTIME
+        seconds, at most MAX_GTEST_SHARDS and one case per shard.
+
+        Returns:
+          int, 1 if the module should not be sharded.
+        """
+        runtime = run_history.ParseDuration(self._runtime_hint)
+        if self._test_type != 'target' or not self._gtest_cases or not runtime:
+            return 1
+        shard_count = int(math.ceil(runtime / GTEST_SHARD_RUNTIME))
+        return max(min(shard_count, MAX_GTEST_SHARDS, len(self._gtest_cases)),
+                   1)
 
     def Prettify(self, elem):
         """Create a pretty-printed XML string for the Element.
@@ -480,6 +792,22 @@ class TestCaseCreator(object):
                 reparsed.toprettyxml(indent="    ")[len(declaration) + 1:])
 
 
+def PrintChangeSummary(changes, dry_run, verbose):
+    """Prints the summary of the files changed by TestCaseCreators.
+
+    Args:
+      changes: list of (path, diff) tuples, sorted by path.
+      dry_run: whether the changes were only computed.
+      verbose: whether to print the full diff of every change.
+    """
+    for path, diff in changes:
+        print path
+        if verbose:
+            print diff
+    print '%d file(s) %s.' % (len(changes), 'to update'
+                               if dry_run else 'updated')
+
+
 LICENSE_STATEMENT_XML = """<!-- Copyright (C) {year} The Android Open Source Project
 
      Licensed under the Apache License, Version 2.0 (the "License");
@@ -532,6 +860,12 @@ VTS_SPEC_PUSH_TEMPLATE = (
     '/data/local/tmp/spec/{package_path}/{hal_version}/{vts_file}')
 VTS_LIB_PUSH_TEMPLATE_32 = 'DATA/lib/{lib_name}->/data/local/tmp/32/{lib_name}'
 VTS_LIB_PUSH_TEMPLATE_64 = 'DATA/lib64/{lib_name}->/data/local/tmp/64/{lib_name}'
+ALL_ABI_BITNESS = ('32', '64')
+# Minimum number of test cases of a binary to run them in batch mode.
+MIN_GTEST_BATCH_CASES = 2
+# Target runtime in seconds of one shard of a gtest module.
+GTEST_SHARD_RUNTIME = 300.0
+MAX_GTEST_SHARDS = 4
 
 VTA_HAL_ADAPTER_MODULE_CONTROLLER = 'com.android.tradefed.module.VtsHalAdapterModuleController'
 VTA_HAL_ADAPTER_PREPARER = 'com.android.tradefed.targetprep.VtsHalAdapterPreparer'
@@ -0,0 +1,218 @@
+#!/usr/bin/env python
+#
+# Copyright 2018 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Read-only view of an existing AndroidTest.xml.
+# Parses the configure once so that generators and schedulers can query the
+# options they need without re-scanning the file line by line.
+
+import os
+import re
+
+from xml.etree import cElementTree as ET
+from utils.const import Constant
+
+
+class TestConfig(object):
+    """Structured content of an AndroidTest.xml.
+
+    Attributes:
+        path: string, path of the parsed configure file.
+        year: int, copyright year in the license header, None if not found.
+        description: string, description of the configuration.
+        plan: string, the plan that the test belongs to.
+        metadata: dict, maps config-descriptor:metadata keys to the lists of
+                  their values.
+        preparer_options: list of (name, value) tuples from the file pusher.
+        test_options: list of (name, value) tuples from the test element.
+    """
+
+    def __init__(self, path):
+        """Parses the configure file at path.
+
+        Args:
+            path: string, path of the AndroidTest.xml file.
+        """
+        self.path = path
+        self.year = None
+        self.description = None
+        self.plan = None
+        self.metadata = {}
+        self.preparer_options = []
+        self.test_options = []
+
+        with open(path, 'r') as configure_file:
+            content = configure_file.read()
+
+        match = re.search(Constant.COPYRIGHT_YEAR_PATTERN, content)
+        if match:
+            self.year = int(match.group(1))
+
+        configuration = ET.fromstring(content)
+        self.description = configuration.get('description')
+        for option in configuration.findall('option'):
+            if option.get('name') != 'config-descriptor:metadata':
+                continue
+            self.metadata.setdefault(option.get('key'), []).append(
+                option.get('value'))
+            if option.get('key') == 'plan':
+                self.plan = option.get('value')
+        for preparer in configuration.findall('target_preparer'):
+            for option in preparer.findall('option'):
+                self.preparer_options.append((option.get('name'),
+                                              option.get('value')))
+        for test in configuration.findall('test'):
+            for option in test.findall('option'):
+                self.test_options.append((option.get('name'),
+                                          option.get('value')))
+
+    def GetTestOption(self, name, default=None):
+        """Returns the value of the first test option with the given name."""
+        for option_name, value in self.test_options:
+            if option_name == name:
+                return value
+        return default
+
+    def GetTestOptions(self, name):
+        """Returns the values of all test options with the given name."""
+        return [
+            value for option_name, value in self.test_options
+            if option_name == name
+        ]
+
+    def GetPreparerOptions(self, name):
+        """Returns the values of all preparer options with the given name."""
+        return [
+            value for option_name, value in self.preparer_options
+            if option_name == name
+        ]
+
+    @property
+    def plans(self):
+        """list of strings, all plans that the test belongs to."""
+        return self.metadata.get('plan', [])
+
+    @property
+    def scheduling_group(self):
+        """string, scheduling group of the module, None if it has none.
+
+        Modules that disable the framework belong to the framework-stopped
+        group even if their configure predates the metadata.
+        """
+        groups = self.metadata.get(Constant.SCHEDULING_GROUP_KEY)
+        if groups:
+            return groups[0]
+        if self.stop_runtime:
+            return Constant.FRAMEWORK_STOPPED_GROUP
+        return None
+
+    @property
+    def push_bundles(self):
+        """list of strings, plans whose push bundle the module depends on."""
+        return self.metadata.get(Constant.PUSH_BUNDLE_KEY, [])
+
+    @property
+    def shard_count(self):
+        """int, number of shards the gtest cases are split into, default 1."""
+        counts = self.metadata.get(Constant.SHARD_COUNT_KEY)
+        return int(counts[0]) if counts else 1
+
+    @property
+    def test_binary(self):
+        """string, name of the target test binary, None for host tests."""
+        for source in self.GetTestOptions('binary-test-source'):
+            return os.path.basename(source)
+        return None
+
+    @property
+    def module_name(self):
+        """string, value of test-module-name."""
+        return self.GetTestOption('test-module-name')
+
+    def GetHalPackageName(self, test_config_dir,
+                          package_root=Constant.HAL_PACKAGE_PREFIX):
+        """Returns the HAL package tested by the module.
+
+        The package follows from the directory of the configure the same way
+        TestCaseCreator.GetHalTestCasePath() lays it out, e.g.
+        wifi/supplicant/V1_0/host is android.hardware.wifi.supplicant@1.0.
+
+        Args:
+            test_config_dir: string, root directory of the test configures.
+            package_root: string, prefix of the HAL packages.
+
+        Returns:
+            string, the HAL package name, None if the module does not test
+            a HAL package, e.g. treble/vintf.
+        """
+        parts = os.path.relpath(os.path.dirname(self.path),
+                                test_config_dir).split(os.sep)
+        for index, part in enumerate(parts):
+            match = re.match(Constant.HAL_VERSION_DIR_PATTERN, part)
+            if match and index:
+                return '%s.%s@%s.%s' % (package_root, '.'.join(parts[:index]),
+                                        match.group(1), match.group(2))
+        return None
+
+    @property
+    def time_out(self):
+        """string, value of test-timeout, default is 1m."""
+        return self.GetTestOption('test-timeout', '1m')
+
+    @property
+    def runtime_hint(self):
+        """string, value of runtime-hint, None if the configure has none."""
+        return self.GetTestOption('runtime-hint')
+
+    @property
+    def stop_runtime(self):
+        """boolean, whether the framework is stopped before the test."""
+        return self.GetTestOption('binary-test-disable-framework') == 'true'
+
+
+def ParseTestConfig(path):
+    """Parses an AndroidTest.xml.
+
+    Args:
+        path: string, path of the configure file.
+
+    Returns:
+        TestConfig object, None if the file is not a valid configure.
+    """
+    try:
+        return TestConfig(path)
+    except (IOError, SyntaxError) as e:
+        print('WARNING: Failed to parse %s: %s' % (path, e))
+        return None
+
+
+def FindTestConfigs(test_config_dir):
+    """Parses every AndroidTest.xml under a directory.
+
+    Args:
+        test_config_dir: string, root directory of the test configures.
+
+    Returns:
+        list of TestConfig objects, sorted by path.
+    """
+    test_configs = []
+    for base, dirs, files in os.walk(test_config_dir):
+        dirs.sort()
+        if 'AndroidTest.xml' in files:
+            test_config = ParseTestConfig(os.path.join(base, 'AndroidTest.xml'))
+            if test_config:
+                test_configs.append(test_config)
+    return test_configs
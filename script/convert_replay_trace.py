@@ -0,0 +1,179 @@
+#!/usr/bin/env python
+#
+# Copyright 2019 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+import argparse
+import os
+import sys
+
+from utils import replay_trace
+"""Convert replay traces to and from the indexed binary trace format.
+
+The binary traces (.vts.btrace, see utils/replay_trace.py) are a fraction of
+the size of the text traces and decode block by block. The replay test of
+the device still reads text traces, so extract turns a binary trace, or the
+calls of one API in it, back into a .vts.trace file for a targeted re-run.
+
+Usage:
+  python convert_replay_trace.py convert TRACE... [--block_records 64]
+  python convert_replay_trace.py info BINARY_TRACE
+  python convert_replay_trace.py extract BINARY_TRACE --output TRACE
+      [--api NAME [--occurrence N] [--through_end]]
+"""
+
+TEXT_TRACE_SUFFIX = '.vts.trace'
+BINARY_TRACE_SUFFIX = '.vts.btrace'
+EXIT_EVENT_SUFFIX = '_EXIT'
+
+
+def BinaryTracePath(path):
+    """Returns the path of the binary trace converted from a text trace."""
+    if path.endswith(TEXT_TRACE_SUFFIX):
+        path = path[:-len(TEXT_TRACE_SUFFIX)]
+    return path + BINARY_TRACE_SUFFIX
+
+
+def Convert(path, block_records):
+    """Converts a text trace to a binary trace next to it.
+
+    Args:
+        path: string, path of the .vts.trace file.
+        block_records: int, number of records per block.
+    """
+    with open(path, 'r') as trace_file:
+        preamble, records = replay_trace.ParseTextTrace(trace_file.read())
+    output = BinaryTracePath(path)
+    with open(output, 'wb') as binary_file:
+        replay_trace.WriteBinaryTrace(binary_file, preamble, records,
+                                      block_records)
+    print '%s: %d record(s), %d -> %d bytes' % (
+        output, len(records), os.path.getsize(path), os.path.getsize(output))
+
+
+def FindCallRange(reader, api, occurrence, through_end):
+    """Returns the record numbers of one call to an API.
+
+    Args:
+        reader: IndexedReader of the binary trace.
+        api: string, name of the API.
+        occurrence: int, 0-based index of the call among the calls to api.
+        through_end: bool, whether to include every record after the call.
+
+    Returns:
+        a pair of the first and last record numbers, None if there are
+        fewer calls.
+    """
+    entries = reader.GetEntries()
+    calls = [
+        number for number in reader.FindCalls(api)
+        if not entries[number][1].endswith(EXIT_EVENT_SUFFIX)
+    ]
+    if occurrence >= len(calls):
+        return None
+    first = calls[occurrence]
+    if through_end:
+        return first, reader.record_count - 1
+    event = entries[first][1]
+    exit_event = event[:event.rfind('_')] + EXIT_EVENT_SUFFIX
+    for number in range(first + 1, reader.record_count):
+        if entries[number][1] == exit_event and entries[number][2] == api:
+            return first, number
+    return first, first
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Convert replay traces to the binary trace format.')
+    parser.add_argument(
+        'command',
+        choices=['convert', 'info', 'extract'],
+        help='convert text traces, describe or extract a binary trace.')
+    parser.add_argument('traces', nargs='+', help='Trace files.')
+    parser.add_argument(
+        '--block_records',
+        dest='block_records',
+        type=int,
+        required=False,
+        default=replay_trace.DEFAULT_BLOCK_RECORDS,
+        help='Number of records per compressed block.')
+    parser.add_argument(
+        '--output',
+        dest='output',
+        required=False,
+        help='Text trace written by extract.')
+    parser.add_argument(
+        '--api',
+        dest='api',
+        required=False,
+        help='Name of the API whose call extract writes.')
+    parser.add_argument(
+        '--occurrence',
+        dest='occurrence',
+        type=int,
+        required=False,
+        default=0,
+        help='0-based index of the call to extract, default is 0.')
+    parser.add_argument(
+        '--through_end',
+        dest='through_end',
+        action='store_true',
+        required=False,
+        help='Also extract every record after the call.')
+    args = parser.parse_args()
+
+    if args.command == 'convert':
+        if args.block_records < 1:
+            print 'Invalid block size. Exiting...'
+            sys.exit(1)
+        for path in args.traces:
+            Convert(path, args.block_records)
+        return
+
+    reader = replay_trace.IndexedReader(args.traces[0])
+    try:
+        if args.command == 'info':
+            calls = {}
+            for _, event, name in reader.GetEntries():
+                if name and not event.endswith(EXIT_EVENT_SUFFIX):
+                    calls[name] = calls.get(name, 0) + 1
+            print '%d record(s)' % reader.record_count
+            for name in sorted(calls):
+                print '  %s: %d call(s)' % (name, calls[name])
+            return
+
+        if not args.output:
+            print 'Missing --output. Exiting...'
+            sys.exit(1)
+        first, last = 0, reader.record_count - 1
+        if args.api:
+            call_range = FindCallRange(reader, args.api, args.occurrence,
+                                       args.through_end)
+            if not call_range:
+                print 'No call %d of %s. Exiting...' % (args.occurrence,
+                                                       args.api)
+                sys.exit(1)
+            first, last = call_range
+        records = list(reader.Records(first, last))
+        with open(args.output, 'w') as trace_file:
+            trace_file.write(
+                replay_trace.FormatTextTrace(reader.preamble, records))
+        print '%s: %d record(s)' % (args.output, len(records))
+    finally:
+        reader.Close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,357 @@
+#!/usr/bin/env python
+#
+# Copyright 2019 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import threading
+
+import plan_scheduler
+
+from configure.test_config import FindTestConfigs
+from utils import gtest_list
+from utils import run_history
+from utils.const import Constant
+from utils.percentile import Percentile
+"""Spread the modules of a plan over several devices.
+
+Every device otherwise runs every module of the plan in plan order, including
+the modules whose HAL the device does not serve, which only skip after
+paying for their setup and pushes. This script:
+  1. reads the HAL instances served by each device, from the capability
+     snapshot cached on the host by device_snapshot.py if the device has not
+     rebooted since, otherwise from lshal,
+  2. prunes on each device the modules whose HAL package it does not serve,
+  3. estimates the duration of the remaining modules from the run history
+     (see record_run_history.py), falling back to their runtime-hint,
+  4. splits the gtest cases of the modules with a shard-count (see
+     TestCaseCreator.GetGtestShardCount) into shards, and assigns the modules
+     and shards longest first to the least loaded device that can run them,
+  5. runs the modules of each device with plan_scheduler.py in parallel. With
+     --framework_stop_window the framework-stopped modules of each device
+     share one window.
+
+Usage:
+  python device_scheduler.py list --plan PLAN [--serial SERIAL ...]
+  python device_scheduler.py run --plan PLAN [--serial SERIAL ...]
+      [--tradefed vts-tradefed] [--run_history FILE] [--gtest_list_dir DIR]
+      [--no_prune] [--framework_stop_window] [--push_bundle BUNDLE ...]
+      [-- extra tradefed args]
+"""
+
+# Snapshot cache of device_snapshot.py, valid while the boot id is unchanged.
+SNAPSHOT_CACHE_FILE = os.path.join(tempfile.gettempdir(),
+                                   Constant.DEVICE_SNAPSHOT_CACHE_FILE)
+LSHAL_COMMAND = 'lshal --neat -itr'
+# Estimated duration of the modules without history nor runtime-hint.
+DEFAULT_RUNTIME = 60.0
+
+
+def AdbShell(serial, command):
+    """Returns the stdout of a shell command on a device."""
+    return subprocess.check_output(['adb', '-s', serial, 'shell', command])
+
+
+def GetDevices():
+    """Returns the serials of the devices listed by adb."""
+    devices = []
+    for line in subprocess.check_output(['adb', 'devices']).splitlines()[1:]:
+        fields = line.split()
+        if len(fields) == 2 and fields[1] == 'device':
+            devices.append(fields[0])
+    return devices
+
+
+def GetServedPackages(serial):
+    """Returns the HAL packages a device serves.
+
+    Args:
+      serial: string, serial of the device.
+
+    Returns:
+      set of strings, e.g. set(['android.hardware.nfc@1.0']).
+    """
+    instances = None
+    try:
+        with open(SNAPSHOT_CACHE_FILE % serial) as cache_file:
+            snapshot = json.load(cache_file)
+        boot_id = AdbShell(serial, Constant.BOOT_ID_COMMAND).strip()
+        if boot_id == snapshot['boot_id']:
+            instances = [instance[0] for instance in snapshot['hal_instances']]
+    except (IOError, ValueError, KeyError, TypeError):
+        pass
+    if instances is None:
+        instances = [
+            line.split()[0]
+            for line in AdbShell(serial, LSHAL_COMMAND).splitlines()
+            if '::' in line
+        ]
+    return set(instance.split('::')[0] for instance in instances)
+
+
+def EstimateRuntime(test_config, history):
+    """Returns the expected duration of a module in seconds.
+
+    Args:
+      test_config: TestConfig object of the module.
+      history: RunHistory object, None to only use the runtime-hint.
+    """
+    if history:
+        durations = history.GetDurations(test_config.module_name)
+        if durations:
+            return Percentile(durations, 50)
+    runtime = run_history.ParseDuration(test_config.runtime_hint)
+    return runtime if runtime is not None else DEFAULT_RUNTIME
+
+
+def SplitShards(test_config, runtime, list_dir):
+    """Splits a module into the shards of its gtest cases.
+
+    Args:
+      test_config: TestConfig object of the module.
+      runtime: float, estimated duration of the whole module in seconds.
+      list_dir: string, directory of the test case lists.
+
+    Returns:
+      list of (TestConfig object, list of cases, estimated seconds) tuples.
+      The list of cases is None for a module that is not sharded.
+    """
+    cases = None
+    if test_config.shard_count > 1 and test_config.test_binary:
+        cases = gtest_list.ReadGtestList(list_dir, test_config.test_binary)
+    if not cases or len(cases) < test_config.shard_count:
+        return [(test_config, None, runtime)]
+    return [(test_config, shard, runtime / test_config.shard_count)
+            for shard in gtest_list.ShardCases(cases, test_config.shard_count)]
+
+
+def Assign(test_configs,
+           devices,
+           test_config_dir,
+           history,
+           list_dir,
+           prune=True):
+    """Bin-packs the modules of a plan over devices, longest first.
+
+    Args:
+      test_configs: list of TestConfig objects of the modules of the plan.
+      devices: dict, maps device serials to the sets of HAL packages they
+               serve.
+      test_config_dir: string, root directory of the test configures.
+      history: RunHistory object, None to only use the runtime-hints.
+      list_dir: string, directory of the test case lists.
+      prune: bool, whether to drop the modules of HALs a device does not
+             serve. Modules that do not test a HAL package run anywhere.
+
+    Returns:
+      a pair of a dict, which maps device serials to (estimated seconds,
+      list of (TestConfig object, list of cases or None)) tuples, and the
+      list of the TestConfig objects no device can run.
+    """
+    assignment = dict((serial, (0.0, [])) for serial in devices)
+    pruned = []
+    units = []
+    for test_config in test_configs:
+        package = test_config.GetHalPackageName(test_config_dir)
+        candidates = [
+            serial for serial in sorted(devices)
+            if not prune or not package or package in devices[serial]
+        ]
+        if not candidates:
+            pruned.append(test_config)
+            continue
+        for unit in SplitShards(test_config,
+                                EstimateRuntime(test_config, history),
+                                list_dir):
+            units.append((unit, candidates))
+    for (test_config, cases, runtime), candidates in sorted(
+            units, key=lambda unit: (-unit[0][2], unit[0][0].module_name)):
+        serial = min(candidates, key=lambda serial: assignment[serial][0])
+        load, assigned = assignment[serial]
+        assigned.append((test_config, cases))
+        assignment[serial] = (load + runtime, assigned)
+    return assignment, pruned
+
+
+def MergeShards(assigned):
+    """Merges the shards of the modules assigned to one device.
+
+    Args:
+      assigned: list of (TestConfig object, list of cases or None) tuples.
+
+    Returns:
+      a pair of the list of TestConfig objects to run and the dict of the
+      case filters of the modules that only run some of their shards, see
+      plan_scheduler.TradefedCommand().
+    """
+    test_configs = {}
+    case_filters = {}
+    for test_config, cases in assigned:
+        test_configs[test_config.module_name] = test_config
+        if cases is not None:
+            case_filters.setdefault(test_config.module_name, []).extend(cases)
+    for module_name in case_filters.keys():
+        test_config = test_configs[module_name]
+        shards = [cases for config, cases in assigned if config is test_config]
+        if len(shards) == test_config.shard_count:
+            del case_filters[module_name]
+    return test_configs.values(), case_filters
+
+
+def RunAssignment(assignment, tradefed, plan, extra_args, stop_window,
+                  bundles):
+    """Runs the modules assigned to every device in parallel.
+
+    Args:
+      assignment: dict returned by Assign().
+      tradefed: string, tradefed console launcher.
+      plan: string, name of the plan.
+      extra_args: list of strings, appended to every tradefed command.
+      stop_window: bool, see plan_scheduler.RunSchedule().
+      bundles: list of strings, push bundles installed on every device, see
+               plan_scheduler.RequiredBundles().
+
+    Returns:
+      int, 0 if every device passed, else the exit code of a failed one.
+    """
+    exit_codes = {}
+
+    def RunDevice(serial, assigned):
+        test_configs, case_filters = MergeShards(assigned)
+        exit_codes[serial] = plan_scheduler.RunSchedule(
+            plan_scheduler.Schedule(test_configs, plan), tradefed, plan,
+            serial, extra_args, case_filters, stop_window, bundles)
+
+    threads = [
+        threading.Thread(target=RunDevice, args=(serial, assigned))
+        for serial, (_, assigned) in assignment.iteritems() if assigned
+    ]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    return max(exit_codes.values() or [0])
+
+
+def main():
+    build_top = os.getenv('ANDROID_BUILD_TOP')
+    if not build_top:
+        print('Error: Missing ANDROID_BUILD_TOP env variable. Please run '
+              '\'. build/envsetup.sh; lunch <build target>\' Exiting...')
+        sys.exit(1)
+
+    parser = argparse.ArgumentParser(
+        description='Spread the modules of a plan over several devices.')
+    parser.add_argument(
+        'command',
+        choices=['list', 'run'],
+        help='list the assignment of the modules or run it.')
+    parser.add_argument(
+        '--plan', dest='plan', required=True, help='Name of the plan.')
+    parser.add_argument(
+        '--serial',
+        dest='serials',
+        action='append',
+        required=False,
+        help='Device serial, can be repeated. Default is every adb device.')
+    parser.add_argument(
+        '--tradefed',
+        dest='tradefed',
+        required=False,
+        default='vts-tradefed',
+        help='Tradefed console launcher, default is vts-tradefed.')
+    parser.add_argument(
+        '--run_history',
+        dest='run_history',
+        required=False,
+        default=run_history.DefaultPath(build_top),
+        help='Run history database written by record_run_history.py.')
+    parser.add_argument(
+        '--gtest_list_dir',
+        dest='gtest_list_dir',
+        required=False,
+        default=gtest_list.DefaultListDir(build_top),
+        help='Test case lists saved by capture_gtest_lists.py.')
+    parser.add_argument(
+        '--no_prune',
+        dest='no_prune',
+        action='store_true',
+        required=False,
+        help='Also run the modules of HALs a device does not serve.')
+    parser.add_argument(
+        '--framework_stop_window',
+        dest='framework_stop_window',
+        action='store_true',
+        required=False,
+        help='Run the framework-stopped modules of each device inside one '
+        'framework stop window.')
+    parser.add_argument(
+        '--push_bundle',
+        dest='push_bundles',
+        action='append',
+        required=False,
+        help='Push bundle built by push_bundle.py, installed on every device '
+        'before its modules run. Can be repeated.')
+    args, extra_args = parser.parse_known_args()
+    extra_args = [arg for arg in extra_args if arg != '--']
+
+    serials = args.serials or GetDevices()
+    if not serials:
+        print 'No device found. Exiting...'
+        sys.exit(1)
+    devices = dict((serial, GetServedPackages(serial)) for serial in serials)
+
+    test_config_dir = os.path.join(build_top, Constant.VTS_HAL_TEST_CASE_PATH)
+    test_configs = [
+        test_config for test_config in FindTestConfigs(test_config_dir)
+        if args.plan in test_config.plans and test_config.module_name
+    ]
+    assignment, pruned = Assign(test_configs, devices, test_config_dir,
+                                run_history.RunHistory(args.run_history),
+                                args.gtest_list_dir, not args.no_prune)
+
+    if args.command == 'list':
+        for serial in sorted(assignment):
+            load, assigned = assignment[serial]
+            print '%s: %d module(s), ~%d s' % (serial, len(assigned), load)
+            for test_config, cases in sorted(
+                    assigned, key=lambda unit: unit[0].module_name):
+                if cases is None:
+                    print '  %s' % test_config.module_name
+                else:
+                    print '  %s (%d case(s))' % (test_config.module_name,
+                                                 len(cases))
+        print 'pruned: %d module(s)' % len(pruned)
+        for test_config in sorted(pruned, key=lambda c: c.module_name):
+            print '  %s' % test_config.module_name
+        return
+
+    bundles, missing = plan_scheduler.RequiredBundles(test_configs,
+                                                      args.push_bundles)
+    if missing:
+        print 'Missing --push_bundle of %s. Exiting...' % ', '.join(missing)
+        sys.exit(1)
+    sys.exit(
+        RunAssignment(assignment, args.tradefed, args.plan, extra_args,
+                      args.framework_stop_window, bundles))
+
+
+if __name__ == '__main__':
+    main()
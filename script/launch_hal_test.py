@@ -23,6 +23,7 @@ import sys
 from build.build_rule_gen import BuildRuleGen
 from build.vts_spec_parser import VtsSpecParser
 from configure.test_case_creator import TestCaseCreator
+from utils import run_history
 from utils.const import Constant
 
 TEST_TIME_OUT_PATTERN = '(([0-9]+)(m|s|h))+'
@@ -34,14 +35,18 @@ Usage:
 
   where options are:
   --test_type: Test type, currently support two types: target and host.
-  --time_out: Timeout for the test, default is 1m.
+  --time_out: Timeout for the test. Derived from the run history if it has
+              enough runs of the module, otherwise default is 1m.
+  --run_history: Run history database written by record_run_history.py.
   --package_root: Prefix of the HAL package. default is android.hardware
   --path_root: Root path that stores the HAL definition. default is hardware/interfaces
   --test_binary_file: Test binary file for target-side HAL test.
   --test_script_file: Test script file for host-side HAL test.
   --test_config_dir: Directory path to store the test configure files.
   --replay: Whether this is a replay test.
+  --profiling: Whether to enable HAL profiling and collect the traces.
   --disable_stop_runtime: Whether to stop framework before the test.
+  --abi_bitness: Bitness of the device ABIs to push vts drivers for.
 Example:
   python launch_hal_test.py android.hardware.nfc@1.0
   python launch_hal_test.py --test_type=host --time_out=5m android.hardware.nfc@1.0
@@ -63,14 +68,26 @@ def main():
         '--time_out',
         dest='time_out',
         required=False,
-        default='1m',
-        help='Timeout for the test, default is 1m.')
+        help='Timeout for the test. Derived from the run history if it has '
+        'enough runs of the module, otherwise default is 1m.')
+    parser.add_argument(
+        '--run_history',
+        dest='run_history',
+        required=False,
+        help='Run history database written by record_run_history.py, '
+        'default is the one under the out directory.')
     parser.add_argument(
         '--replay',
         dest='is_replay',
         action='store_true',
         required=False,
         help='Whether this is a replay test.')
+    parser.add_argument(
+        '--profiling',
+        dest='is_profiling',
+        action='store_true',
+        required=False,
+        help='Whether to enable HAL profiling and collect the traces.')
     parser.add_argument(
         '--disable_stop_runtime',
         dest='disable_stop_runtime',
@@ -105,6 +122,13 @@ def main():
         dest='test_config_dir',
         required=False,
         help='Directory path to store the test configure files.')
+    parser.add_argument(
+        '--abi_bitness',
+        dest='abi_bitness',
+        required=False,
+        default='32,64',
+        help='Comma separated bitness of the device ABIs to push vts drivers '
+        'for, default is 32,64.')
     parser.add_argument(
         'hal_package_name',
         help='hal package name (e.g. android.hardware.nfc@1.0).')
@@ -127,11 +151,19 @@ def main():
         print 'Host side replay test is not supported yet. Exiting...'
         sys.exit(1)
 
-    regex = re.compile(TEST_TIME_OUT_PATTERN)
-    result = re.match(regex, args.time_out)
-    if not result:
-        print 'Invalid test time out format. Exiting...'
-        sys.exit(1)
+    history = None
+    if args.time_out:
+        regex = re.compile(TEST_TIME_OUT_PATTERN)
+        result = re.match(regex, args.time_out)
+        if not result:
+            print 'Invalid test time out format. Exiting...'
+            sys.exit(1)
+    else:
+        args.time_out = '1m'
+        build_top = os.getenv('ANDROID_BUILD_TOP')
+        if args.run_history or build_top:
+            history = run_history.RunHistory(
+                args.run_history or run_history.DefaultPath(build_top))
 
     if not args.test_config_dir:
         if args.package_root == Constant.HAL_PACKAGE_PREFIX:
@@ -150,12 +182,15 @@ def main():
             args.test_type,
             args.time_out,
             is_replay=args.is_replay,
+            is_profiling=args.is_profiling,
             stop_runtime=stop_runtime,
             test_binary_file=args.test_binary_file,
             test_script_file=args.test_script_file,
             test_config_dir=args.test_config_dir,
             package_root=args.package_root,
-            path_root=args.path_root):
+            path_root=args.path_root,
+            abi_bitness=args.abi_bitness.split(','),
+            run_history=history):
         print('Error: Failed to launch test for %s. Exiting...' %
               args.hal_package_name)
         sys.exit(1)
@@ -0,0 +1,293 @@
+#!/usr/bin/env python
+#
+# Copyright 2019 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+import argparse
+import os
+import subprocess
+import sys
+
+import push_bundle
+
+from configure.test_config import FindTestConfigs
+from utils.const import Constant
+"""Run the modules of a plan grouped by the device state they need.
+
+Every module with binary-test-disable-framework stops the framework before
+its tests and restarts it afterwards, which takes tens of seconds. This
+script runs the other modules of the plan first and the modules of the
+framework-stopped scheduling group (see TestConfig.scheduling_group) in a
+second tradefed invocation.
+
+With --framework_stop_window, the second invocation runs inside one window:
+  1. the framework is stopped once and
+     Constant.FRAMEWORK_STOP_WINDOW_PROPERTY is set,
+  2. the grouped modules run with binary-test-disable-framework overridden
+     to false, host tests leave the framework alone while the property is
+     set (see framework_window.py),
+  3. the framework is started again and the property is cleared.
+The whole invocation then runs without the framework, including the device
+availability checks of tradefed and the preparers of the plan, which expect
+it to be running. The window is therefore opt-in, for tradefed setups known
+to tolerate a stopped framework.
+
+Modules whose configures omit the files of a plan push bundle (see
+push_bundle.py) only run if the bundle is given with --push_bundle. It is
+installed on the device before tradefed runs.
+
+Usage:
+  python plan_scheduler.py list --plan PLAN
+  python plan_scheduler.py run --plan PLAN [--serial SERIAL]
+      [--tradefed vts-tradefed] [--framework_stop_window]
+      [--push_bundle BUNDLE ...] [-- extra tradefed args]
+"""
+
+WAIT_BOOT_COMPLETED = ('while [ "$(getprop sys.boot_completed)" != 1 ]; '
+                       'do sleep 1; done')
+
+
+def Schedule(test_configs, plan):
+    """Orders the modules of a plan into scheduling windows.
+
+    Args:
+      test_configs: list of TestConfig objects.
+      plan: string, name of the plan, e.g. vts-hal.
+
+    Returns:
+      list of (scheduling group, list of TestConfig objects) tuples. The
+      modules without a group come first, under the group None.
+    """
+    groups = {}
+    for test_config in test_configs:
+        if plan not in test_config.plans or not test_config.module_name:
+            continue
+        groups.setdefault(test_config.scheduling_group, []).append(test_config)
+    schedule = []
+    for group in sorted(groups, key=lambda group: (group is not None, group)):
+        schedule.append(
+            (group, sorted(groups[group], key=lambda c: c.module_name)))
+    return schedule
+
+
+def TradefedCommand(tradefed,
+                    plan,
+                    test_configs,
+                    serial,
+                    extra_args,
+                    in_window,
+                    case_filters=None):
+    """Builds the tradefed command line that runs a list of modules.
+
+    Args:
+      tradefed: string, tradefed console launcher, e.g. vts-tradefed.
+      plan: string, name of the plan.
+      test_configs: list of TestConfig objects of the modules to run.
+      serial: string, serial of the device, None for the default device.
+      extra_args: list of strings, appended to the command.
+      in_window: bool, whether the modules run inside a framework stop
+                 window, so that they must not stop the framework.
+      case_filters: dict, maps the names of the modules that only run a
+                    shard of their cases to the lists of these cases.
+
+    Returns:
+      list of strings, the command.
+    """
+    cmd = [tradefed, 'run', 'commandAndExit', plan]
+    if serial:
+        cmd += ['-s', serial]
+    for test_config in test_configs:
+        cmd += ['--include-filter', test_config.module_name]
+        if in_window and test_config.stop_runtime:
+            cmd += [
+                '--module-arg',
+                '%s:binary-test-disable-framework:false' %
+                test_config.module_name
+            ]
+        for case in (case_filters or {}).get(test_config.module_name, []):
+            cmd += [
+                '--module-arg',
+                '%s:include-filter:%s' % (test_config.module_name, case)
+            ]
+    return cmd + extra_args
+
+
+def RequiredBundles(test_configs, bundle_paths):
+    """Selects the push bundles that modules depend on.
+
+    Args:
+      test_configs: list of TestConfig objects of the modules to run.
+      bundle_paths: list of strings, archives built by push_bundle.py.
+
+    Returns:
+      a pair of the list of the archives to install and the sorted list of
+      the plans whose bundle is needed but not given.
+    """
+    plans = set(plan for test_config in test_configs
+                for plan in test_config.push_bundles)
+    bundles = dict((push_bundle.BundlePlan(path)[0], path)
+                   for path in bundle_paths or [])
+    return ([bundles[plan] for plan in sorted(plans & set(bundles))],
+            sorted(plans - set(bundles)))
+
+
+def Adb(serial, *args):
+    """Runs an adb command."""
+    cmd = ['adb']
+    if serial:
+        cmd += ['-s', serial]
+    subprocess.check_call(cmd + list(args))
+
+
+def OpenWindow(serial):
+    """Stops the framework and marks the window as open."""
+    Adb(serial, 'root')
+    Adb(serial, 'wait-for-device')
+    Adb(serial, 'shell',
+        'setprop %s 1' % Constant.FRAMEWORK_STOP_WINDOW_PROPERTY)
+    Adb(serial, 'shell', 'stop')
+
+
+def CloseWindow(serial):
+    """Starts the framework, waits for boot completion and closes the window."""
+    Adb(serial, 'wait-for-device')
+    Adb(serial, 'shell', 'start')
+    Adb(serial, 'shell', WAIT_BOOT_COMPLETED)
+    Adb(serial, 'shell',
+        'setprop %s 0' % Constant.FRAMEWORK_STOP_WINDOW_PROPERTY)
+
+
+def RunSchedule(schedule,
+                tradefed,
+                plan,
+                serial,
+                extra_args,
+                case_filters=None,
+                stop_window=False,
+                bundles=None):
+    """Runs every window of a schedule with tradefed.
+
+    Args:
+      schedule: list returned by Schedule().
+      tradefed: string, tradefed console launcher.
+      plan: string, name of the plan.
+      serial: string, serial of the device, None for the default device.
+      extra_args: list of strings, appended to every tradefed command.
+      case_filters: dict, see TradefedCommand().
+      stop_window: bool, whether the framework-stopped group runs inside one
+                   framework stop window.
+      bundles: list of strings, push bundles installed before the first
+               window, see RequiredBundles().
+
+    Returns:
+      int, 0 if every tradefed invocation succeeded, else the last non-zero
+      exit code.
+    """
+    for bundle in bundles or []:
+        push_bundle.InstallBundle(bundle, serial)
+    exit_code = 0
+    for group, test_configs in schedule:
+        in_window = (stop_window and
+                     group == Constant.FRAMEWORK_STOPPED_GROUP)
+        cmd = TradefedCommand(tradefed, plan, test_configs, serial,
+                              extra_args, in_window, case_filters)
+        print 'Running %d module(s) of group %s' % (len(test_configs), group)
+        try:
+            if in_window:
+                OpenWindow(serial)
+            result = subprocess.call(cmd)
+        finally:
+            if in_window:
+                CloseWindow(serial)
+        if result:
+            exit_code = result
+    return exit_code
+
+
+def main():
+    build_top = os.getenv('ANDROID_BUILD_TOP')
+    if not build_top:
+        print('Error: Missing ANDROID_BUILD_TOP env variable. Please run '
+              '\'. build/envsetup.sh; lunch <build target>\' Exiting...')
+        sys.exit(1)
+
+    parser = argparse.ArgumentParser(
+        description='Run the modules of a plan in scheduling windows.')
+    parser.add_argument(
+        'command',
+        choices=['list', 'run'],
+        help='list the schedule of a plan or run it.')
+    parser.add_argument(
+        '--plan', dest='plan', required=True, help='Name of the plan.')
+    parser.add_argument(
+        '--serial', dest='serial', required=False, help='Device serial.')
+    parser.add_argument(
+        '--tradefed',
+        dest='tradefed',
+        required=False,
+        default='vts-tradefed',
+        help='Tradefed console launcher, default is vts-tradefed.')
+    parser.add_argument(
+        '--framework_stop_window',
+        dest='framework_stop_window',
+        action='store_true',
+        required=False,
+        help='Run the framework-stopped modules inside one framework stop '
+        'window.')
+    parser.add_argument(
+        '--push_bundle',
+        dest='push_bundles',
+        action='append',
+        required=False,
+        help='Push bundle built by push_bundle.py, installed before the '
+        'modules run. Can be repeated.')
+    args, extra_args = parser.parse_known_args()
+    extra_args = [arg for arg in extra_args if arg != '--']
+
+    schedule = Schedule(
+        FindTestConfigs(
+            os.path.join(build_top, Constant.VTS_HAL_TEST_CASE_PATH)),
+        args.plan)
+
+    if args.command == 'list':
+        for group, test_configs in schedule:
+            print '%s: %d module(s)' % (group, len(test_configs))
+            for test_config in test_configs:
+                print '  %s' % test_config.module_name
+            if (args.framework_stop_window and
+                    group == Constant.FRAMEWORK_STOPPED_GROUP):
+                print '  %d framework restart(s) saved' % (
+                    len(test_configs) - 1)
+        return
+
+    bundles, missing = RequiredBundles(
+        [test_config for _, test_configs in schedule
+         for test_config in test_configs], args.push_bundles)
+    if missing:
+        print 'Missing --push_bundle of %s. Exiting...' % ', '.join(missing)
+        sys.exit(1)
+    sys.exit(
+        RunSchedule(
+            schedule,
+            args.tradefed,
+            args.plan,
+            args.serial,
+            extra_args,
+            stop_window=args.framework_stop_window,
+            bundles=bundles))
+
+
+if __name__ == '__main__':
+    main()
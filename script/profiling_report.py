@@ -0,0 +1,215 @@
+#!/usr/bin/env python
+#
+# Copyright 2019 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+import argparse
+import json
+import os
+import re
+import sys
+
+from utils import gen_manifest
+from utils import latency_stats
+from utils import replay_trace
+"""Aggregate HAL API latencies of target_profiling runs and diff builds.
+
+The target_profiling modules run the target tests with HAL profiling
+enabled, and the profiler writes one trace per HAL package, e.g.
+android.hardware.light_2.0_19050569395.vts.trace, which tradefed collects
+with the logs of the run. This script:
+  record: finds the traces under result directories, pairs the entry and
+          exit records of every call and stores the latency distribution of
+          every HAL API under a build id in the results database. APIs are
+          told apart by interface and event kind, and only the time spent in
+          the HAL (replay_trace.LATENCY_EVENT_KINDS) is recorded,
+  builds: lists the recorded builds,
+  diff:   compares two builds and prints the APIs whose median latency
+          regressed under the rule of utils/latency_stats.py, ranked by the
+          relative increase.
+
+Usage:
+  python profiling_report.py record --build ID --results DIR [--results DIR]
+  python profiling_report.py builds
+  python profiling_report.py diff --base ID --target ID [--tolerance 0.1]
+      [--min_delta_us 50] [--min_calls 5] [--top N]
+"""
+
+TRACE_FILE_RE = re.compile(r'^(.+)_(\d+)\.(\d+)_\d+\.vts\.b?trace$')
+NANOS_PER_MICRO = 1000.0
+
+
+def FindTraces(result_dirs):
+    """Returns the sorted paths of the profiling traces under directories."""
+    traces = []
+    for result_dir in result_dirs:
+        for root, _, files in os.walk(result_dir):
+            for name in files:
+                if TRACE_FILE_RE.match(name):
+                    traces.append(os.path.join(root, name))
+    return sorted(traces)
+
+
+def CollectLatencies(trace_paths):
+    """Groups the call latencies of traces by HAL API.
+
+    Args:
+        trace_paths: list of strings, paths of the profiling traces.
+
+    Returns:
+        dict, maps APIs, e.g. 'android.hardware.nfc@1.0::INfc::open
+        (SERVER_API)', to lists of latencies in microseconds.
+    """
+    latencies = {}
+    for path in trace_paths:
+        match = TRACE_FILE_RE.match(os.path.basename(path))
+        package = '%s@%s.%s' % match.groups()
+        for key, latency in replay_trace.CallLatencies(
+                replay_trace.ReadTrace(path)):
+            api = '%s::%s' % (package, replay_trace.ApiName(key))
+            latencies.setdefault(api, []).append(latency / NANOS_PER_MICRO)
+    return latencies
+
+
+def LoadDatabase(path):
+    """Returns the results database, empty if it does not exist."""
+    if not os.path.isfile(path):
+        return {}
+    with open(path, 'r') as database_file:
+        return json.load(database_file)
+
+
+def SaveDatabase(path, database):
+    """Writes the results database."""
+    dir_path = os.path.dirname(path)
+    if dir_path and not os.path.exists(dir_path):
+        os.makedirs(dir_path)
+    with open(path, 'w') as database_file:
+        json.dump(database, database_file, indent=2, sort_keys=True)
+
+
+def main():
+    build_top = os.getenv('ANDROID_BUILD_TOP')
+    if not build_top:
+        print('Error: Missing ANDROID_BUILD_TOP env variable. Please run '
+              '\'. build/envsetup.sh; lunch <build target>\' Exiting...')
+        sys.exit(1)
+
+    parser = argparse.ArgumentParser(
+        description='Aggregate and diff HAL API latencies of builds.')
+    parser.add_argument(
+        'command',
+        choices=['record', 'builds', 'diff'],
+        help='record the latencies of a build, list builds or diff two.')
+    parser.add_argument(
+        '--database',
+        dest='database',
+        required=False,
+        default=gen_manifest.DefaultManifestPath(build_top,
+                                                 'profiling_results'),
+        help='Path of the results database.')
+    parser.add_argument(
+        '--build', dest='build', required=False, help='Build id to record.')
+    parser.add_argument(
+        '--results',
+        dest='results',
+        action='append',
+        required=False,
+        help='Directory with the results of a profiling run, can be '
+        'repeated.')
+    parser.add_argument(
+        '--base', dest='base', required=False, help='Build id to diff from.')
+    parser.add_argument(
+        '--target', dest='target', required=False, help='Build id to diff.')
+    parser.add_argument(
+        '--tolerance',
+        dest='tolerance',
+        type=float,
+        required=False,
+        default=latency_stats.DEFAULT_TOLERANCE,
+        help='Relative increase of the median latency below which an API '
+        'is not reported, default is %s.' % latency_stats.DEFAULT_TOLERANCE)
+    parser.add_argument(
+        '--min_delta_us',
+        dest='min_delta_us',
+        type=float,
+        required=False,
+        default=latency_stats.DEFAULT_MIN_DELTA_US,
+        help='Increase of the median latency in microseconds below which an '
+        'API is not reported, default is %s.' %
+        latency_stats.DEFAULT_MIN_DELTA_US)
+    parser.add_argument(
+        '--min_calls',
+        dest='min_calls',
+        type=int,
+        required=False,
+        default=latency_stats.DEFAULT_MIN_CALLS,
+        help='Minimum number of calls of an API in both builds, default is '
+        '%s.' % latency_stats.DEFAULT_MIN_CALLS)
+    parser.add_argument(
+        '--top',
+        dest='top',
+        type=int,
+        required=False,
+        help='Number of regressions to print, default is all.')
+    args = parser.parse_args()
+
+    database = LoadDatabase(args.database)
+
+    if args.command == 'record':
+        if not args.build or not args.results:
+            print 'Missing --build or --results. Exiting...'
+            sys.exit(1)
+        traces = FindTraces(args.results)
+        if not traces:
+            print 'No profiling trace found. Exiting...'
+            sys.exit(1)
+        latencies = CollectLatencies(traces)
+        database[args.build] = dict(
+            (api, latency_stats.Distribution(values))
+            for api, values in latencies.iteritems())
+        SaveDatabase(args.database, database)
+        print '%s: %d trace(s), %d API(s)' % (args.build, len(traces),
+                                              len(latencies))
+        return
+
+    if args.command == 'builds':
+        for build in sorted(database):
+            print '%s: %d API(s)' % (build, len(database[build]))
+        return
+
+    for build in (args.base, args.target):
+        if build not in database:
+            print 'Build %s is not recorded. Exiting...' % build
+            sys.exit(1)
+    base = database[args.base]
+    target = database[args.target]
+    regressions = latency_stats.FindRegressions(
+        base, target, args.tolerance, args.min_delta_us, args.min_calls)
+    print '%d API(s) slower in %s than in %s' % (len(regressions),
+                                                  args.target, args.base)
+    for increase, api, before, after in regressions[:args.top]:
+        print '%+6.1f%% %s: p50 %.1f -> %.1f us, p99 %.1f -> %.1f us' % (
+            increase * 100, api, before['p50'], after['p50'], before['p99'],
+            after['p99'])
+    only_base = len(set(base) - set(target))
+    only_target = len(set(target) - set(base))
+    if only_base or only_target:
+        print '%d API(s) only in %s, %d only in %s' % (
+            only_base, args.base, only_target, args.target)
+
+
+if __name__ == '__main__':
+    main()
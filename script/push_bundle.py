@@ -0,0 +1,273 @@
+#!/usr/bin/env python
+#
+# Copyright 2018 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+import argparse
+import hashlib
+import os
+import subprocess
+import sys
+import tarfile
+
+from configure.test_config import FindTestConfigs
+from utils import gen_manifest
+from utils.const import Constant
+"""Build and install per-plan bundles of the files pushed by many modules.
+
+Many modules of a plan push the same vts specs and driver libraries (e.g.
+the specs of android.hardware.graphics.common@1.0) and delete them again
+with cleanup=true. This script collects the push entries shared by at least
+two modules of a plan into one archive named by the hash of its content.
+The archive is pushed and extracted once per device, and only if the hash
+recorded on the device differs. Next to the archive, build writes the list of
+bundled push entries, which update_hal_tests.py --bundled_pushes uses to drop
+those entries from the configures of the modules of that plan, so that
+cleanup=true of a module no longer deletes them.
+
+Tradefed does not install the bundle. The configures that omit bundled
+entries carry push-bundle metadata, and plan_scheduler.py and
+device_scheduler.py refuse to run them unless the bundle of their plan is
+given with --push_bundle, which they install before running tradefed.
+
+The shared entries are computed from the push entries the generator produced
+for each configure, which update_hal_tests.py records in its manifest before
+dropping the bundled ones, so rebuilding a bundle after the configures were
+updated yields the same bundle.
+
+Usage:
+  python push_bundle.py list [--plan PLAN]
+  python push_bundle.py build --plan PLAN --testcases_dir DIR --out_dir DIR
+  python push_bundle.py install --bundle FILE [--serial SERIAL]
+"""
+
+DEVICE_BUNDLE_DIR = '/data/local/tmp/push_bundle'
+PUSH_SEPARATOR = '->'
+
+
+def ModulePushes(test_config, manifest):
+    """Returns the push entries of a module before bundling.
+
+    Args:
+      test_config: TestConfig object of the module.
+      manifest: GenManifest of update_hal_tests.py, None to only read the
+                configure.
+
+    Returns:
+      set of strings, the entries of the configure and the ones the
+      generator produced for it, including those left to the bundle.
+    """
+    pushes = set(test_config.GetPreparerOptions('push'))
+    if manifest:
+        pushes.update(manifest.GetPushes(test_config.path) or [])
+    return pushes
+
+
+def SharedPushes(test_configs, plan, manifest=None, min_modules=2):
+    """Returns the push entries shared by several modules of a plan.
+
+    Args:
+      test_configs: list of TestConfig objects.
+      plan: string, name of the plan, e.g. vts-hal-replay.
+      manifest: GenManifest of update_hal_tests.py, see ModulePushes().
+      min_modules: int, minimum number of modules pushing an entry.
+
+    Returns:
+      dict, maps push entry (source->destination) to the number of modules
+      of the plan pushing it.
+    """
+    counts = {}
+    for test_config in test_configs:
+        if plan not in test_config.plans:
+            continue
+        for push in ModulePushes(test_config, manifest):
+            if PUSH_SEPARATOR in push:
+                counts[push] = counts.get(push, 0) + 1
+    return dict((push, count) for push, count in counts.iteritems()
+                if count >= min_modules)
+
+
+def BundleHash(testcases_dir, pushes):
+    """Computes the content hash of a bundle.
+
+    Args:
+      testcases_dir: string, directory that the push sources are relative to.
+      pushes: list of push entries.
+
+    Returns:
+      string, hex sha1 digest over the destinations and file contents.
+    """
+    sha = hashlib.sha1()
+    for push in sorted(pushes):
+        source, destination = push.split(PUSH_SEPARATOR)
+        with open(os.path.join(testcases_dir, source), 'rb') as source_file:
+            sha.update(destination)
+            sha.update(hashlib.sha1(source_file.read()).hexdigest())
+    return sha.hexdigest()
+
+
+def BuildBundle(testcases_dir, pushes, plan, out_dir):
+    """Creates the bundle archive of a plan.
+
+    Entries whose source file does not exist (e.g. a driver of an ABI that
+    was not built) are skipped.
+
+    Args:
+      testcases_dir: string, directory that the push sources are relative to.
+      pushes: list of push entries.
+      plan: string, name of the plan.
+      out_dir: string, directory to write the archive to.
+
+    Returns:
+      string, path of the archive, named <plan>-<hash>.tar.gz. The bundled
+      push entries are listed in <plan>.pushes in the same directory.
+    """
+    existing_pushes = [
+        push for push in sorted(pushes)
+        if os.path.isfile(
+            os.path.join(testcases_dir, push.split(PUSH_SEPARATOR)[0]))
+    ]
+    bundle_hash = BundleHash(testcases_dir, existing_pushes)
+    if not os.path.exists(out_dir):
+        os.makedirs(out_dir)
+    bundle_path = os.path.join(out_dir, '%s-%s.tar.gz' % (plan, bundle_hash))
+    with open(os.path.join(out_dir, plan + '.pushes'), 'w') as pushes_file:
+        pushes_file.write(''.join(push + '\n' for push in existing_pushes))
+    if os.path.exists(bundle_path):
+        print 'Skipping %s' % bundle_path
+        return bundle_path
+
+    with tarfile.open(bundle_path, 'w:gz') as bundle:
+        for push in existing_pushes:
+            source, destination = push.split(PUSH_SEPARATOR)
+            info = bundle.gettarinfo(
+                os.path.join(testcases_dir, source),
+                arcname=destination.lstrip('/'))
+            info.mtime = 0
+            info.uid = info.gid = 0
+            info.uname = info.gname = ''
+            with open(os.path.join(testcases_dir, source), 'rb') as f:
+                bundle.addfile(info, f)
+    print 'Created %s with %d files' % (bundle_path, len(existing_pushes))
+    return bundle_path
+
+
+def Adb(serial, *args):
+    """Runs an adb command and returns its stdout."""
+    cmd = ['adb']
+    if serial:
+        cmd += ['-s', serial]
+    return subprocess.check_output(cmd + list(args))
+
+
+def BundlePlan(bundle_path):
+    """Returns the plan and the hash of a <plan>-<hash>.tar.gz archive."""
+    bundle_name = os.path.basename(bundle_path)[:-len('.tar.gz')]
+    return tuple(bundle_name.rsplit('-', 1))
+
+
+def InstallBundle(bundle_path, serial=None):
+    """Pushes and extracts a bundle unless the device already has it.
+
+    Args:
+      bundle_path: string, path of a <plan>-<hash>.tar.gz archive.
+      serial: string, serial of the device, None for the default device.
+
+    Returns:
+      True if the bundle was pushed, False if it was already installed.
+    """
+    plan, bundle_hash = BundlePlan(bundle_path)
+    bundle_name = '%s-%s' % (plan, bundle_hash)
+    hash_file = '%s/%s.sha1' % (DEVICE_BUNDLE_DIR, plan)
+    installed_hash = Adb(serial, 'shell', 'cat %s 2>/dev/null' % hash_file)
+    if installed_hash.strip() == bundle_hash:
+        print 'Bundle %s already installed' % bundle_name
+        return False
+
+    device_bundle = '%s/%s.tar.gz' % (DEVICE_BUNDLE_DIR, plan)
+    Adb(serial, 'shell', 'mkdir -p %s' % DEVICE_BUNDLE_DIR)
+    Adb(serial, 'push', bundle_path, device_bundle)
+    Adb(serial, 'shell', 'tar -xzf %s -C / && rm %s && echo %s > %s' %
+        (device_bundle, device_bundle, bundle_hash, hash_file))
+    print 'Installed bundle %s' % bundle_name
+    return True
+
+
+def main():
+    build_top = os.getenv('ANDROID_BUILD_TOP')
+    if not build_top:
+        print('Error: Missing ANDROID_BUILD_TOP env variable. Please run '
+              '\'. build/envsetup.sh; lunch <build target>\' Exiting...')
+        sys.exit(1)
+
+    parser = argparse.ArgumentParser(
+        description='Build and install per-plan push bundles.')
+    parser.add_argument(
+        'command',
+        choices=['list', 'build', 'install'],
+        help='list shared pushes, build a bundle or install a bundle.')
+    parser.add_argument(
+        '--plan', dest='plan', required=False, help='Name of the plan.')
+    parser.add_argument(
+        '--testcases_dir',
+        dest='testcases_dir',
+        required=False,
+        help='Directory that the push sources are relative to, e.g. '
+        'android-vts/testcases.')
+    parser.add_argument(
+        '--out_dir',
+        dest='out_dir',
+        required=False,
+        help='Directory to write the bundle to.')
+    parser.add_argument(
+        '--bundle', dest='bundle', required=False, help='Bundle to install.')
+    parser.add_argument(
+        '--serial', dest='serial', required=False, help='Device serial.')
+    args = parser.parse_args()
+
+    if args.command == 'install':
+        if not args.bundle:
+            print 'Missing --bundle. Exiting...'
+            sys.exit(1)
+        InstallBundle(args.bundle, args.serial)
+        return
+
+    test_configs = FindTestConfigs(
+        os.path.join(build_top, Constant.VTS_HAL_TEST_CASE_PATH))
+    manifest = gen_manifest.GenManifest(
+        gen_manifest.DefaultManifestPath(build_top, 'test_configs'))
+    plans = sorted(set(plan for test_config in test_configs
+                       for plan in test_config.plans))
+    if args.plan:
+        plans = [args.plan]
+
+    if args.command == 'list':
+        for plan in plans:
+            shared_pushes = SharedPushes(test_configs, plan, manifest)
+            saved = sum(count - 1 for count in shared_pushes.itervalues())
+            print '%s: %d shared files, %d pushes saved' % (
+                plan, len(shared_pushes), saved)
+        return
+
+    if not args.plan or not args.testcases_dir or not args.out_dir:
+        print 'build requires --plan, --testcases_dir and --out_dir. Exiting...'
+        sys.exit(1)
+    BuildBundle(args.testcases_dir,
+                SharedPushes(test_configs, args.plan, manifest), args.plan,
+                args.out_dir)
+
+
+if __name__ == '__main__':
+    main()
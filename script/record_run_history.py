@@ -0,0 +1,110 @@
+#!/usr/bin/env python
+#
+# Copyright 2019 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+import argparse
+import os
+import sys
+
+from utils import run_history
+"""Record the module durations of test runs in the run history database.
+
+update_hal_tests.py and launch_hal_test.py --run_history derive test-timeout
+and runtime-hint of the configures from this database.
+
+Usage:
+  python record_run_history.py record [--history FILE]
+      --result_file test_result.xml [--result_file test_result.xml ...]
+  python record_run_history.py show [--history FILE] [--percentile 95]
+      [--headroom 1.5] [--min_samples 3]
+"""
+
+
+def main():
+    build_top = os.getenv('ANDROID_BUILD_TOP')
+    if not build_top:
+        print('Error: Missing ANDROID_BUILD_TOP env variable. Please run '
+              '\'. build/envsetup.sh; lunch <build target>\' Exiting...')
+        sys.exit(1)
+
+    parser = argparse.ArgumentParser(
+        description='Record and show the durations of test modules.')
+    parser.add_argument(
+        'command',
+        choices=['record', 'show'],
+        help='record the modules of result files or show the history.')
+    parser.add_argument(
+        '--history',
+        dest='history',
+        required=False,
+        default=run_history.DefaultPath(build_top),
+        help='Path of the run history database.')
+    parser.add_argument(
+        '--percentile',
+        dest='percentile',
+        type=int,
+        required=False,
+        default=95,
+        help='Percentile of the durations the timeout is based on, '
+        'default is 95.')
+    parser.add_argument(
+        '--headroom',
+        dest='headroom',
+        type=float,
+        required=False,
+        default=1.5,
+        help='Factor applied to the percentile, default is 1.5.')
+    parser.add_argument(
+        '--min_samples',
+        dest='min_samples',
+        type=int,
+        required=False,
+        default=3,
+        help='Minimum number of runs of a module, default is 3.')
+    parser.add_argument(
+        '--result_file',
+        dest='result_files',
+        action='append',
+        required=False,
+        help='test_result.xml written by tradefed, can be repeated.')
+    args = parser.parse_args()
+
+    history = run_history.RunHistory(args.history, args.percentile,
+                                     args.headroom, args.min_samples)
+    if args.command == 'record':
+        if not args.result_files:
+            print 'No result file given. Exiting...'
+            sys.exit(1)
+        for result_file in args.result_files:
+            added = history.AddResultFile(result_file)
+            if added is None:
+                print '%s: already recorded' % result_file
+            else:
+                print '%s: %d module run(s)' % (result_file, added)
+        history.Save()
+        return
+
+    for module in history.GetModules():
+        durations = history.GetDurations(module)
+        suggestion = history.Suggest(module)
+        print '%s: %d run(s), max %.0f s, test-timeout %s, runtime-hint %s' % (
+            module, len(durations), max(durations),
+            suggestion[0] if suggestion else '-',
+            suggestion[1] if suggestion else '-')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,189 @@
+#!/usr/bin/env python
+#
+# Copyright 2019 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+import argparse
+import json
+import sys
+
+from utils import latency_stats
+from utils import replay_trace
+"""Detect per-call latency regressions of a HAL against replay traces.
+
+A replay module checks that the replayed calls return the recorded results,
+but not how long the HAL took. The traces hold the entry and exit timestamps
+of every call, so the latencies of the calls recorded while the HAL was
+replayed can be compared with the latencies recorded in the original trace,
+or with a baseline saved from an earlier vendor drop.
+
+The target_replay_profiling modules (see launch_hal_test.py --replay
+--profiling), e.g. VtsHalLightV2_0TargetReplayProfiling, replay the traces
+of their HAL with HAL profiling enabled. The profiler traces, e.g.
+android.hardware.light_2.0_<timestamp>.vts.trace, are collected with the
+logs of the run. To use such a module as a latency regression test:
+  1. run it on the reference build and save a baseline from its traces:
+       replay_latency.py baseline --output light.json --trace TRACE ...
+  2. run it on the build under test and compare:
+       replay_latency.py compare --baseline light.json --replayed TRACE ...
+     which exits with 1 if an API regressed.
+
+The replay runner of the vts framework issues the recorded calls back to back,
+without the gaps between them in the original trace, so the latencies are
+those of a HAL under continuous load. Replaying with the recorded pacing
+needs support in that runner, which is outside this tree.
+
+Calls are told apart by interface and by event kind, and only the time
+spent in the HAL (replay_trace.LATENCY_EVENT_KINDS) is measured, since the
+client side of a binderized call includes the binder transaction.
+
+APIs regress under the same rule as in profiling_report.py diff, see
+utils/latency_stats.py: the median latency must exceed the baseline median
+by more than the relative tolerance and by more than min_delta_us, and the
+API must be called at least min_calls times on both sides.
+
+Usage:
+  python replay_latency.py baseline --output FILE --trace TRACE
+      [--trace TRACE ...]
+  python replay_latency.py compare --replayed TRACE [--replayed TRACE ...]
+      (--baseline FILE | --recorded TRACE [--recorded TRACE ...])
+      [--tolerance 0.1] [--min_delta_us 50] [--min_calls 5]
+
+Traces can be text .vts.trace files or .vts.btrace files.
+"""
+
+NANOS_PER_MICRO = 1000.0
+
+
+def LatencyStats(trace_paths):
+    """Computes the latency statistics of the APIs called in traces.
+
+    Args:
+        trace_paths: list of strings, paths of the trace files.
+
+    Returns:
+        dict, maps API names, e.g. 'INfc::open (SERVER_API)', to
+        latency_stats.Distribution() results in microseconds.
+    """
+    latencies = {}
+    for path in trace_paths:
+        for key, latency in replay_trace.CallLatencies(
+                replay_trace.ReadTrace(path)):
+            latencies.setdefault(replay_trace.ApiName(key), []).append(
+                latency / NANOS_PER_MICRO)
+    return dict((name, latency_stats.Distribution(values))
+                for name, values in latencies.iteritems())
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Compare the call latencies of replay traces.')
+    parser.add_argument(
+        'command',
+        choices=['baseline', 'compare'],
+        help='save a latency baseline or compare a replay with one.')
+    parser.add_argument(
+        '--trace',
+        dest='traces',
+        action='append',
+        required=False,
+        help='Trace the baseline is computed from, can be repeated.')
+    parser.add_argument(
+        '--output',
+        dest='output',
+        required=False,
+        help='Baseline file written by baseline.')
+    parser.add_argument(
+        '--baseline',
+        dest='baseline',
+        required=False,
+        help='Baseline file written by baseline.')
+    parser.add_argument(
+        '--recorded',
+        dest='recorded',
+        action='append',
+        required=False,
+        help='Recorded trace used as baseline, can be repeated.')
+    parser.add_argument(
+        '--replayed',
+        dest='replayed',
+        action='append',
+        required=False,
+        help='Trace recorded while replaying, can be repeated.')
+    parser.add_argument(
+        '--tolerance',
+        dest='tolerance',
+        type=float,
+        required=False,
+        default=latency_stats.DEFAULT_TOLERANCE,
+        help='Allowed relative increase of the median latency, default is '
+        '%s.' % latency_stats.DEFAULT_TOLERANCE)
+    parser.add_argument(
+        '--min_delta_us',
+        dest='min_delta_us',
+        type=float,
+        required=False,
+        default=latency_stats.DEFAULT_MIN_DELTA_US,
+        help='Increase of the median latency in microseconds that is never '
+        'a regression, default is %s.' % latency_stats.DEFAULT_MIN_DELTA_US)
+    parser.add_argument(
+        '--min_calls',
+        dest='min_calls',
+        type=int,
+        required=False,
+        default=latency_stats.DEFAULT_MIN_CALLS,
+        help='Minimum number of calls of an API on both sides, default is '
+        '%s.' % latency_stats.DEFAULT_MIN_CALLS)
+    args = parser.parse_args()
+
+    if args.command == 'baseline':
+        if not args.traces or not args.output:
+            print 'Missing traces or --output. Exiting...'
+            sys.exit(1)
+        stats = LatencyStats(args.traces)
+        with open(args.output, 'w') as baseline_file:
+            json.dump(stats, baseline_file, indent=2, sort_keys=True)
+        print '%s: %d API(s)' % (args.output, len(stats))
+        return
+
+    if not args.replayed or bool(args.baseline) == bool(args.recorded):
+        print('Need --replayed and one of --baseline or --recorded. '
+              'Exiting...')
+        sys.exit(1)
+    if args.baseline:
+        with open(args.baseline, 'r') as baseline_file:
+            baseline = json.load(baseline_file)
+    else:
+        baseline = LatencyStats(args.recorded)
+    replayed = LatencyStats(args.replayed)
+
+    for name in sorted(replayed):
+        if name in baseline:
+            print '%s: p50 %.1f us -> %.1f us, p95 %.1f us -> %.1f us' % (
+                name, baseline[name]['p50'], replayed[name]['p50'],
+                baseline[name]['p95'], replayed[name]['p95'])
+        else:
+            print '%s: p50 %.1f us, no baseline' % (name,
+                                                   replayed[name]['p50'])
+    regressions = latency_stats.FindRegressions(
+        baseline, replayed, args.tolerance, args.min_delta_us, args.min_calls)
+    for increase, name, before, after in regressions:
+        print 'REGRESSION: %s median latency %.1f us -> %.1f us (%+.1f%%)' % (
+            name, before['p50'], after['p50'], increase * 100)
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -15,18 +15,46 @@
 # limitations under the License.
 #
 import argparse
+import multiprocessing
 import os
 import sys
 
+from multiprocessing.pool import ThreadPool
+
 from build.vts_spec_parser import VtsSpecParser
+from utils import gen_manifest
+from configure.test_case_creator import PrintChangeSummary
 from configure.test_case_creator import TestCaseCreator
 """Regenerate test configures for all hal adapter tests.
 
 Usage:
-  python update_hal_adapter_tests.py [-h] cts_hal_mapping_dir
+  python update_hal_adapter_tests.py [-h] [--jobs N] [--dry_run] [--verbose]
+      cts_hal_mapping_dir
 """
 
 
+def UpdateHalAdapterTest(vts_spec_parser, manifest, hal_package_name,
+                         mapping_dir_path, dry_run):
+    """Regenerates the adapter test configure of one hal.
+
+    Args:
+      vts_spec_parser: VtsSpecParser shared by all workers.
+      manifest: GenManifest shared by all workers.
+      hal_package_name: string, e.g. android.hardware.nfc@1.1.
+      mapping_dir_path: directory that stores the cts_hal_mapping files.
+      dry_run: whether to only compute the changes without writing.
+
+    Returns:
+      list of (path, diff) tuples of the changed configures.
+    """
+    test_case_creater = TestCaseCreator(vts_spec_parser, hal_package_name,
+                                        manifest)
+    test_case_creater.LaunchTestCase(
+        test_type='adapter', mapping_dir_path=mapping_dir_path,
+        dry_run=dry_run)
+    return test_case_creater.GetChanges()
+
+
 def main():
     build_top = os.getenv('ANDROID_BUILD_TOP')
     if not build_top:
@@ -39,22 +67,56 @@ def main():
     parser.add_argument(
         'cts_hal_mapping_dir',
         help='Directory that stores cts_hal_mapping files.')
+    parser.add_argument(
+        '--jobs',
+        dest='jobs',
+        type=int,
+        required=False,
+        default=multiprocessing.cpu_count(),
+        help='Number of hals to update in parallel.')
+    parser.add_argument(
+        '--dry_run',
+        dest='dry_run',
+        action='store_true',
+        required=False,
+        help='Only print the configures that would be updated.')
+    parser.add_argument(
+        '--verbose',
+        dest='verbose',
+        action='store_true',
+        required=False,
+        help='Print the diff of every updated configure.')
     args = parser.parse_args()
 
     vts_spec_parser = VtsSpecParser()
     hal_list = vts_spec_parser.HalNamesAndVersions()
+    manifest = gen_manifest.GenManifest(
+        gen_manifest.DefaultManifestPath(build_top, 'adapter_test_configs'))
 
+    adapter_packages = []
     for hal_name, hal_version in hal_list:
         hal_package_name = 'android.hardware.' + hal_name + '@' + hal_version
         major_version, minor_version = hal_version.split('.')
         if int(minor_version) > 0:
             lower_version = major_version + '.' + str(int(minor_version) - 1)
             if (hal_name, lower_version) in hal_list:
-                test_case_creater = TestCaseCreator(vts_spec_parser,
-                                                    hal_package_name)
-                test_case_creater.LaunchTestCase(
-                    test_type='adapter',
-                    mapping_dir_path=args.cts_hal_mapping_dir)
+                adapter_packages.append(hal_package_name)
+
+    pool = ThreadPool(max(args.jobs, 1))
+    try:
+        results = pool.map(
+            lambda package: UpdateHalAdapterTest(
+                vts_spec_parser, manifest, package, args.cts_hal_mapping_dir,
+                args.dry_run),
+            adapter_packages)
+    finally:
+        pool.close()
+        pool.join()
+
+    if not args.dry_run:
+        manifest.Save()
+    changes = sorted(change for result in results for change in result)
+    PrintChangeSummary(changes, args.dry_run, args.verbose)
 
 
 if __name__ == '__main__':
@@ -16,62 +16,97 @@
 #
 
 import argparse
+import multiprocessing
 import os
 import re
 import sys
 
+from multiprocessing.pool import ThreadPool
+
+from configure.test_case_creator import PrintChangeSummary
 from configure.test_case_creator import TestCaseCreator
+from configure.test_config import ParseTestConfig
 from build.vts_spec_parser import VtsSpecParser
+from utils import gen_manifest
+from utils import run_history
 """Regenerate test configures for all existing tests.
 
 Usage:
-  python update_hal_tests.py
+  python update_hal_tests.py [--jobs N] [--dry_run] [--verbose]
+      [--abi_bitness 32,64] [--bundled_pushes PLAN.pushes ...]
+      [--run_history FILE] [--timeout_percentile 95] [--timeout_headroom 1.5]
+      [--min_samples 3]
+
+Modules with at least min_samples runs in the run history (see
+record_run_history.py) get their test-timeout and runtime-hint from it. The
+other modules keep the values of their current configures.
 """
 
+# Suffix of the files listing the push entries of a bundle, see push_bundle.py.
+PUSHES_FILE_SUFFIX = '.pushes'
 
-def GetTimeOut(configure_path):
-    """Get the timeout settings from the original configure.
-
-    Args:
-      configure_path: path of the original configure file.
+test_categories = {
+    'target': ('target/AndroidTest.xml', 'target', False),
+    'target_profiling': ('target_profiling/AndroidTest.xml', 'target', True),
+    'host': ('host/AndroidTest.xml', 'host', False),
+    'host_profiling': ('host_profiling/AndroidTest.xml', 'host', True),
+}
 
-    Returns:
-      timeout values.
-    """
-    time_out = "1m"
-    configure_file = open(configure_path, "r")
-    for line in configure_file.readlines():
-        if "test-timeout" in line:
-            temp = line[(line.find("value") + 7):]
-            time_out = temp[0:temp.find('"')]
-            break
-    return time_out
 
+def UpdateHalTests(vts_spec_parser, manifest, build_top, hal_name,
+                   hal_version, dry_run, abi_bitness, bundled_pushes,
+                   history):
+    """Regenerates all test configures of one hal.
 
-def GetDisableRunTime(configure_path):
-    """Get the stop runtime settings from the original configure.
+    Runs in a worker thread. Every worker shares the same VtsSpecParser so
+    that the .vts specs of a package are generated and parsed only once.
 
     Args:
-      configure_path: path of the original configure file.
+      vts_spec_parser: VtsSpecParser shared by all workers.
+      manifest: GenManifest shared by all workers.
+      build_top: string, equal to environment variable ANDROID_BUILD_TOP.
+      hal_name: string, name of the hal, e.g. 'vibrator'.
+      hal_version: string, version of the hal, e.g '1.0'.
+      dry_run: whether to only compute the changes without writing.
+      abi_bitness: list of strings, bitness of the vts drivers to push.
+      bundled_pushes: dict, maps plan names to the sets of push entries
+                      provided by their push bundles.
+      history: RunHistory shared by all workers, None to keep the timeouts.
 
     Returns:
-      Settings about whether to stop runtime before test.
+      list of (path, diff) tuples of the changed configures.
     """
-    disable_runtime = False
-    configure_file = open(configure_path, "r")
-    for line in configure_file.readlines():
-        if "binary-test-disable-framework" in line:
-            disable_runtime = True
-            break
-    return disable_runtime
-
-
-test_categories = {
-    'target': ('target/AndroidTest.xml', 'target', False),
-    'target_profiling': ('target_profiling/AndroidTest.xml', 'target', True),
-    'host': ('host/AndroidTest.xml', 'host', False),
-    'host_profiling': ('host_profiling/AndroidTest.xml', 'host', True),
-}
+    hal_package_name = 'android.hardware.' + hal_name + '@' + hal_version
+    test_case_creater = TestCaseCreator(vts_spec_parser, hal_package_name,
+                                        manifest)
+    hal_path = hal_name.replace(".", "/")
+    hal_version_str = 'V' + hal_version.replace('.', '_')
+    hal_test_path = os.path.join(build_top, 'test/vts-testcase/hal', hal_path,
+                                 hal_version_str)
+
+    for test_categry in sorted(test_categories):
+        configure = test_categories[test_categry]
+        test_configure_path = os.path.join(hal_test_path, configure[0])
+        if not os.path.exists(test_configure_path):
+            continue
+        test_config = ParseTestConfig(test_configure_path)
+        if not test_config:
+            continue
+        test_case_creater.LaunchTestCase(
+            configure[1],
+            time_out=test_config.time_out,
+            runtime_hint=test_config.runtime_hint,
+            run_history=history,
+            gtest_batch_mode=test_config.GetTestOption(
+                'gtest-batch-mode') == 'true',
+            is_profiling=configure[2],
+            stop_runtime=test_config.stop_runtime,
+            scheduling_group=test_config.scheduling_group,
+            update_only=True,
+            dry_run=dry_run,
+            abi_bitness=abi_bitness,
+            bundled_pushes=bundled_pushes)
+    return test_case_creater.GetChanges()
 
 
 def main():
@@ -81,30 +116,110 @@ def main():
               '\'. build/envsetup.sh; lunch <build target>\' Exiting...')
         sys.exit(1)
 
+    parser = argparse.ArgumentParser(
+        description='Update vts hal test configures.')
+    parser.add_argument(
+        '--jobs',
+        dest='jobs',
+        type=int,
+        required=False,
+        default=multiprocessing.cpu_count(),
+        help='Number of hals to update in parallel.')
+    parser.add_argument(
+        '--dry_run',
+        dest='dry_run',
+        action='store_true',
+        required=False,
+        help='Only print the configures that would be updated.')
+    parser.add_argument(
+        '--verbose',
+        dest='verbose',
+        action='store_true',
+        required=False,
+        help='Print the diff of every updated configure.')
+    parser.add_argument(
+        '--abi_bitness',
+        dest='abi_bitness',
+        required=False,
+        default='32,64',
+        help='Comma separated bitness of the device ABIs to push vts drivers '
+        'for, default is 32,64.')
+    parser.add_argument(
+        '--bundled_pushes',
+        dest='bundled_pushes',
+        action='append',
+        required=False,
+        help='<plan>.pushes file listing the push entries of a plan push '
+        'bundle built by push_bundle.py, these entries are omitted from the '
+        'configures of the modules of that plan, which must then be run by '
+        'plan_scheduler.py or device_scheduler.py with --push_bundle. Can be '
+        'repeated.')
+    parser.add_argument(
+        '--run_history',
+        dest='run_history',
+        required=False,
+        default=run_history.DefaultPath(build_top),
+        help='Run history database written by record_run_history.py.')
+    parser.add_argument(
+        '--timeout_percentile',
+        dest='timeout_percentile',
+        type=int,
+        required=False,
+        default=95,
+        help='Percentile of the module durations the test-timeout is based '
+        'on, default is 95.')
+    parser.add_argument(
+        '--timeout_headroom',
+        dest='timeout_headroom',
+        type=float,
+        required=False,
+        default=1.5,
+        help='Factor applied to the percentile, default is 1.5.')
+    parser.add_argument(
+        '--min_samples',
+        dest='min_samples',
+        type=int,
+        required=False,
+        default=3,
+        help='Minimum number of recorded runs of a module to derive its '
+        'test-timeout from, default is 3.')
+    args = parser.parse_args()
+
     vts_spec_parser = VtsSpecParser()
     hal_list = vts_spec_parser.HalNamesAndVersions()
-
-    for hal_name, hal_version in hal_list:
-        hal_package_name = 'android.hardware.' + hal_name + '@' + hal_version
-        test_case_creater = TestCaseCreator(vts_spec_parser, hal_package_name)
-        hal_path = hal_name.replace(".", "/")
-        hal_version_str = 'V' + hal_version.replace('.', '_')
-        hal_test_path = os.path.join(build_top, 'test/vts-testcase/hal',
-                                     hal_path, hal_version_str)
-
-        for test_categry, configure in test_categories.iteritems():
-            print test_categry
-            print configure
-            test_configure_path = os.path.join(hal_test_path, configure[0])
-            if os.path.exists(test_configure_path):
-                time_out = GetTimeOut(test_configure_path)
-                stop_runtime = GetDisableRunTime(test_configure_path)
-                test_case_creater.LaunchTestCase(
-                    configure[1],
-                    time_out=time_out,
-                    is_profiling=configure[2],
-                    stop_runtime=stop_runtime,
-                    update_only=True)
+    manifest = gen_manifest.GenManifest(
+        gen_manifest.DefaultManifestPath(build_top, 'test_configs'))
+
+    history = run_history.RunHistory(args.run_history,
+                                     args.timeout_percentile,
+                                     args.timeout_headroom, args.min_samples)
+
+    bundled_pushes = {}
+    for pushes_path in args.bundled_pushes or []:
+        plan = os.path.basename(pushes_path)
+        if plan.endswith(PUSHES_FILE_SUFFIX):
+            plan = plan[:-len(PUSHES_FILE_SUFFIX)]
+        with open(pushes_path, 'r') as pushes_file:
+            bundled_pushes[plan] = set(line.strip()
+                                       for line in pushes_file.readlines()
+                                       if line.strip())
+
+    pool = ThreadPool(max(args.jobs, 1))
+    try:
+        results = pool.map(
+            lambda hal: UpdateHalTests(vts_spec_parser, manifest, build_top,
+                                       hal[0], hal[1], args.dry_run,
+                                       args.abi_bitness.split(','),
+                                       bundled_pushes, history),
+            hal_list)
+    finally:
+        pool.close()
+        pool.join()
+
+    if not args.dry_run:
+        manifest.Save()
+    changes = sorted(change for result in results for change in result)
+    PrintChangeSummary(changes, args.dry_run, args.verbose)
 
 
 if __name__ == '__main__':
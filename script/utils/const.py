@@ -21,13 +21,34 @@ class Constant(object):
     BP_WARNING_HEADER = (
         '// This file was auto-generated. Do not edit manually.\n'
         '// Use launch_hal_test.py or update_makefiles.py in test/vts-testcase/hal/script/ to generate this file.\n\n')
+    # Regular expression for the year in the license header of a generated file.
+    COPYRIGHT_YEAR_PATTERN = 'Copyright \(C\) ([0-9]{4})'
     # Default path that stores the Google defined HAL interface.
     HAL_INTERFACE_PATH = 'hardware/interfaces'
     # Regular expression for HAL package names.
     HAL_PACKAGE_NAME_PATTERN = '(([a-zA-Z_0-9]*)(?:[.][a-zA-Z_0-9]*)*)@([0-9]+)[.]([0-9]+)'
     # Default package root for Google defined HAL interface.
     HAL_PACKAGE_PREFIX = 'android.hardware'
+    # Regular expression for the version directory of a HAL test, e.g. V1_0.
+    HAL_VERSION_DIR_PATTERN = '^V([0-9]+)_([0-9]+)$'
     # Default path that stores HAL traces, used for replay tests.
     HAL_TRACE_PATH = 'test/vts-testcase/hal-trace'
+    # Metadata key of the scheduling group of a test module.
+    SCHEDULING_GROUP_KEY = 'scheduling-group'
+    # Metadata key of the plans whose push bundle provides files of a module.
+    PUSH_BUNDLE_KEY = 'push-bundle'
+    # Metadata key of the number of shards a gtest module is split into.
+    SHARD_COUNT_KEY = 'shard-count'
+    # Scheduling group of the modules that run with the framework stopped.
+    FRAMEWORK_STOPPED_GROUP = 'framework-stopped'
+    # Device property set to 1 while the framework-stopped group of a plan
+    # runs, read by framework_window.py. debug.* properties can be set from
+    # the adb shell.
+    FRAMEWORK_STOP_WINDOW_PROPERTY = 'debug.vts.framework_stop_window'
+    # Command printing the boot id, which changes on every boot of a device.
+    BOOT_ID_COMMAND = 'cat /proc/sys/kernel/random/boot_id'
+    # File name, in the host temp directory, of the device snapshot cache of a
+    # device serial, written by device_snapshot.py.
+    DEVICE_SNAPSHOT_CACHE_FILE = 'vts_device_snapshot_%s.json'
     # Default path for VTS test configure files.
     VTS_HAL_TEST_CASE_PATH = 'test/vts-testcase/hal'
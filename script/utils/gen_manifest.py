@@ -0,0 +1,202 @@
+#
+# Copyright 2018 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Manifest of generated files and the inputs they were generated from.
+
+Generators record, for every output file, a hash of all of its inputs
+(template, .hal sources, options) and a hash of the written content. When
+neither the inputs nor the file on disk changed, rendering and writing the
+file can be skipped entirely, which keeps the mtime of the file stable and
+avoids rebuilding the modules that depend on it.
+"""
+
+import hashlib
+import json
+import os
+import threading
+
+# Bump whenever the output of the generators changes for the same inputs.
+GENERATOR_VERSION = 4
+
+
+def HashContent(content):
+    """Returns the hex sha1 digest of a string."""
+    return hashlib.sha1(content).hexdigest()
+
+
+def HashInputs(*inputs):
+    """Returns a hash over a list of generator inputs.
+
+    Args:
+        inputs: values convertible to string with repr(), e.g. strings,
+                numbers, booleans, lists and tuples of those.
+
+    Returns:
+        string, hex sha1 digest.
+    """
+    sha = hashlib.sha1(str(GENERATOR_VERSION))
+    for value in inputs:
+        sha.update(repr(value))
+        sha.update('\0')
+    return sha.hexdigest()
+
+
+def HashHalSources(build_top, path_root, hal_name, hal_version):
+    """Returns a hash of the .hal files of a hal package.
+
+    Args:
+        build_top: string, equal to environment variable ANDROID_BUILD_TOP.
+        path_root: string, root path that stores the hal definition.
+        hal_name: string, name of the hal, e.g. 'vibrator'.
+        hal_version: string, version of the hal, e.g '1.0'.
+
+    Returns:
+        string, hex sha1 digest. Empty string if the package has no .hal
+        file under path_root.
+    """
+    hal_dir = os.path.join(build_top, path_root, hal_name.replace('.', '/'),
+                           hal_version)
+    if not os.path.isdir(hal_dir):
+        return ''
+    sha = hashlib.sha1()
+    for file_name in sorted(os.listdir(hal_dir)):
+        if not file_name.endswith('.hal'):
+            continue
+        with open(os.path.join(hal_dir, file_name), 'r') as hal_file:
+            sha.update(file_name)
+            sha.update(HashContent(hal_file.read()))
+    return sha.hexdigest()
+
+
+class GenManifest(object):
+    """Thread-safe manifest of generated files.
+
+    Attributes:
+        path: string, path of the json file that stores the manifest.
+        entries: dict, maps output file path to a dict with keys
+                 'inputs' (input hash), 'output' (content hash),
+                 'deps' (list of strings recorded by the generator) and
+                 'pushes' (push entries of the file before the plan push
+                 bundle was applied).
+    """
+
+    def __init__(self, path):
+        """Loads the manifest from path if it exists.
+
+        Args:
+            path: string, path of the json file that stores the manifest.
+        """
+        self._path = path
+        self._lock = threading.Lock()
+        self._entries = {}
+        self._dirty = False
+        if os.path.isfile(path):
+            try:
+                with open(path, 'r') as manifest_file:
+                    self._entries = json.load(manifest_file)
+            except ValueError:
+                print 'WARNING: Ignoring corrupted manifest %s' % path
+
+    def GetDeps(self, output_path):
+        """Returns the deps recorded for output_path at the last generation."""
+        with self._lock:
+            entry = self._entries.get(output_path)
+            return list(entry['deps']) if entry else []
+
+    def GetPushes(self, output_path):
+        """Returns the push entries recorded for output_path, None if none."""
+        with self._lock:
+            entry = self._entries.get(output_path)
+            if not entry or 'pushes' not in entry:
+                return None
+            return list(entry['pushes'])
+
+    def IsUpToDate(self, output_path, inputs_hash):
+        """Checks whether output_path needs to be regenerated.
+
+        Args:
+            output_path: string, path of the generated file.
+            inputs_hash: string, hash of the current inputs of the file.
+
+        Returns:
+            True iff the file was generated from the same inputs and was not
+            modified since.
+        """
+        with self._lock:
+            entry = self._entries.get(output_path)
+        if not entry or entry['inputs'] != inputs_hash:
+            return False
+        if not os.path.isfile(output_path):
+            return False
+        with open(output_path, 'r') as output_file:
+            return HashContent(output_file.read()) == entry['output']
+
+    def Record(self, output_path, inputs_hash, content, deps=None,
+               pushes=None):
+        """Records the inputs and content of a generated file.
+
+        Args:
+            output_path: string, path of the generated file.
+            inputs_hash: string, hash of the inputs of the file.
+            content: string, content of the file.
+            deps: list of strings, extra dependencies to remember for the
+                  next generation, e.g. imported packages.
+            pushes: list of strings, push entries the generator produced for
+                    the file, including the ones left to the push bundle.
+        """
+        with self._lock:
+            self._entries[output_path] = {
+                'inputs': inputs_hash,
+                'output': HashContent(content),
+                'deps': sorted(deps or []),
+            }
+            if pushes is not None:
+                self._entries[output_path]['pushes'] = sorted(pushes)
+            self._dirty = True
+
+    def Save(self):
+        """Writes the manifest back to disk if it was modified."""
+        with self._lock:
+            if not self._dirty:
+                return
+            dir_path = os.path.dirname(self._path)
+            if dir_path and not os.path.exists(dir_path):
+                os.makedirs(dir_path)
+            with open(self._path, 'w') as manifest_file:
+                json.dump(self._entries, manifest_file, indent=2,
+                          sort_keys=True)
+            self._dirty = False
+
+
+def DefaultGenDir(build_top):
+    """Returns the directory under the out directory for generator state.
+
+    Args:
+        build_top: string, equal to environment variable ANDROID_BUILD_TOP.
+    """
+    out_dir = os.getenv('OUT_DIR', os.path.join(build_top, 'out'))
+    if not os.path.isabs(out_dir):
+        out_dir = os.path.join(build_top, out_dir)
+    return os.path.join(out_dir, 'vts-hal-gen')
+
+
+def DefaultManifestPath(build_top, name):
+    """Returns the default location of a manifest under the out directory.
+
+    Args:
+        build_top: string, equal to environment variable ANDROID_BUILD_TOP.
+        name: string, name of the generator, e.g. 'test_configs'.
+    """
+    return os.path.join(DefaultGenDir(build_top), name + '.json')
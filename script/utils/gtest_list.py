@@ -0,0 +1,97 @@
+#
+# Copyright 2019 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Test case lists of gtest binaries.
+
+The lists are the --gtest_list_tests output of the target test binaries,
+saved by capture_gtest_lists.py after a build. TestCaseCreator sizes the
+gtest batching and sharding of a module by them, and device_scheduler.py
+splits the cases of a sharded module with them.
+"""
+
+import os
+
+from utils import gen_manifest
+
+DISABLED_PREFIX = 'DISABLED_'
+
+
+def DefaultListDir(build_top):
+    """Returns the default directory of the saved test case lists."""
+    return os.path.join(gen_manifest.DefaultGenDir(build_top), 'gtest_lists')
+
+
+def ListPath(list_dir, test_binary):
+    """Returns the path of the test case list of a binary.
+
+    Args:
+        list_dir: string, directory of the test case lists.
+        test_binary: string, name of the binary, e.g.
+                     VtsHalNfcV1_0TargetTest.
+    """
+    return os.path.join(list_dir, test_binary + '.txt')
+
+
+def ParseGtestList(content):
+    """Parses the output of --gtest_list_tests.
+
+    Args:
+        content: string, the output. Suites are listed as 'Suite.' followed
+                 by their cases indented by two spaces. Both can carry a
+                 '# TypeParam' or '# GetParam()' comment.
+
+    Returns:
+        list of strings, the enabled test cases, e.g. 'Suite.Case'.
+    """
+    cases = []
+    suite = None
+    for line in content.splitlines():
+        name = line.split('#')[0].strip()
+        if not name:
+            continue
+        if not line.startswith(' '):
+            suite = name
+            continue
+        if not suite or suite.startswith(DISABLED_PREFIX) or name.startswith(
+                DISABLED_PREFIX):
+            continue
+        cases.append(suite + name)
+    return cases
+
+
+def ReadGtestList(list_dir, test_binary):
+    """Returns the saved test cases of a binary, None if not saved."""
+    try:
+        with open(ListPath(list_dir, test_binary), 'r') as list_file:
+            return ParseGtestList(list_file.read())
+    except IOError:
+        return None
+
+
+def ShardCases(cases, shard_count):
+    """Splits test cases into shards of about the same size.
+
+    Args:
+        cases: list of strings, the test cases.
+        shard_count: int, number of shards, at most the number of cases.
+
+    Returns:
+        list of shard_count non-empty lists of test cases. Consecutive
+        cases, which usually share a fixture, stay in the same shard.
+    """
+    return [
+        cases[index * len(cases) // shard_count:(index + 1) * len(cases) //
+              shard_count] for index in range(shard_count)
+    ]
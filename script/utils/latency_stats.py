@@ -0,0 +1,83 @@
+#
+# Copyright 2019 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Latency distributions of HAL APIs and their regressions.
+
+Shared by profiling_report.py and replay_latency.py, so that a build diff
+and a replay comparison flag an API under the same rule.
+"""
+
+from utils.percentile import Percentile
+
+PERCENTILES = (50, 90, 95, 99)
+
+# An API regresses if its median latency grows by more than DEFAULT_TOLERANCE
+# and by more than DEFAULT_MIN_DELTA_US, which keeps short calls from
+# flagging on scheduling noise, and if it was called at least
+# DEFAULT_MIN_CALLS times on both sides.
+DEFAULT_TOLERANCE = 0.1
+DEFAULT_MIN_DELTA_US = 50.0
+DEFAULT_MIN_CALLS = 5
+
+
+def Distribution(values):
+    """Summarizes a non-empty list of latencies.
+
+    Args:
+        values: list of latencies.
+
+    Returns:
+        dict with the 'count' and 'mean' of the latencies, and their
+        PERCENTILES, e.g. 'p50'.
+    """
+    distribution = {
+        'count': len(values),
+        'mean': sum(values) / len(values),
+    }
+    for percent in PERCENTILES:
+        distribution['p%d' % percent] = Percentile(values, percent)
+    return distribution
+
+
+def FindRegressions(base, target, tolerance=DEFAULT_TOLERANCE,
+                    min_delta_us=DEFAULT_MIN_DELTA_US,
+                    min_calls=DEFAULT_MIN_CALLS):
+    """Ranks the APIs whose median latency grew.
+
+    Args:
+        base: dict, maps APIs to Distribution() results in microseconds.
+        target: dict, maps APIs to Distribution() results in microseconds.
+        tolerance: float, relative increase of the median latency below
+                   which an API does not regress.
+        min_delta_us: float, increase of the median latency in microseconds
+                      below which an API does not regress.
+        min_calls: int, minimum number of calls of an API on both sides.
+
+    Returns:
+        list of (relative increase, API, base distribution, target
+        distribution) tuples, largest increase first.
+    """
+    regressions = []
+    for api in set(base) & set(target):
+        before = base[api]
+        after = target[api]
+        if min(before['count'], after['count']) < min_calls:
+            continue
+        if not before['p50'] or after['p50'] - before['p50'] <= min_delta_us:
+            continue
+        increase = after['p50'] / before['p50'] - 1
+        if increase > tolerance:
+            regressions.append((increase, api, before, after))
+    return sorted(regressions, key=lambda item: (-item[0], item[1]))
@@ -0,0 +1,41 @@
+#
+# Copyright 2019 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Percentiles of measured durations and latencies.
+
+Shared by the scripts and, as vts.testcases.hal.script.utils.percentile, by
+the host-side benchmarks, so that all of them report the same statistic.
+"""
+
+import math
+
+
+def Percentile(values, percent):
+    """Returns the nearest-rank percentile of a non-empty list of numbers.
+
+    The result is the smallest value such that at least percent percent of
+    the values are less than or equal to it, e.g. the p50 of [1, 2, 3, 4] is
+    2 and the p99 of 10 values is their maximum.
+
+    Args:
+        values: list of numbers.
+        percent: number between 0 and 100.
+
+    Returns:
+        one of the values.
+    """
+    ordered = sorted(values)
+    rank = int(math.ceil(percent / 100.0 * len(ordered)))
+    return ordered[max(rank, 1) - 1]
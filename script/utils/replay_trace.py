@@ -0,0 +1,424 @@
+#
+# Copyright 2019 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Compact indexed binary format of the .vts.trace replay traces.
+
+A .vts.trace file is a text VtsProfilingMessage, a sequence of 'records {'
+blocks, one per HAL API entry or exit event. The binary format keeps the
+text of every record unchanged, but groups the records in zlib compressed
+blocks that decode on their own, followed by an index:
+
+  header:  MAGIC, uint32 version, uint32 length + text before the records
+  blocks:  uint32 compressed length, uint32 record count,
+           uint64 first timestamp, then the compressed records, each a
+           uint32 length and the record text
+  index:   BLOCK_INDEX_MAGIC, uint32 block count, then per block its
+           uint64 offset and uint32 first record number,
+           uint32 record count, then per record its uint64 timestamp,
+           uint16 event id, uint16 API name id,
+           uint32 name count, then every name as uint16 length and text
+  trailer: uint64 offset of the index, TRAILER_MAGIC
+
+StreamReader decodes the blocks in order from a file object, e.g. a pipe
+that is still being written, so records can be replayed as soon as their
+block arrived. IndexedReader uses the index to find the calls of an API and
+to decode only the blocks from there.
+
+CallLatencies() pairs the entry and exit records of the calls, so that the
+latencies of a trace recorded while replaying can be compared with those of
+the recorded trace. A binderized call is recorded by both the client and the
+server, so only the LATENCY_EVENT_KINDS measure the time spent in the HAL.
+"""
+
+import re
+import struct
+import zlib
+
+MAGIC = 'VTSBTRC\0'
+BLOCK_INDEX_MAGIC = 'VTSBIDX\0'
+TRAILER_MAGIC = 'VTSBEND\0'
+VERSION = 1
+# Records per block, small enough that replay starts after the first few KB.
+DEFAULT_BLOCK_RECORDS = 64
+# Event kinds whose entry to exit time is the time spent in the HAL: the
+# server side of binderized calls and the calls into passthrough HALs.
+LATENCY_EVENT_KINDS = ('SERVER_API', 'PASSTHROUGH')
+
+HEADER_FORMAT = '<I'
+BLOCK_HEADER_FORMAT = '<IIQ'
+BLOCK_INDEX_FORMAT = '<QI'
+RECORD_INDEX_FORMAT = '<QHH'
+TRAILER_FORMAT = '<Q'
+
+TIMESTAMP_RE = re.compile(r'\btimestamp:\s*(\d+)')
+EVENT_RE = re.compile(r'\bevent:\s*(\w+)')
+INTERFACE_RE = re.compile(r'\binterface:\s*"([^"]*)"')
+FUNC_MSG_RE = re.compile(r'\bfunc_msg\s*\{')
+FUNC_NAME_RE = re.compile(r'\bfunc_msg\s*\{[^{}]*?\bname:\s*"([^"]*)"')
+RECORDS_RE = re.compile(r'\brecords\s*\{')
+
+
+class Record(object):
+    """One record of a trace.
+
+    Attributes:
+        text: string, the text proto of the record, 'records { ... }'.
+        timestamp: int, timestamp of the event in nanoseconds, 0 if absent.
+        event: string, e.g. 'SERVER_API_ENTRY', '' if absent.
+        name: string, name of the called API, '' if absent.
+        interface: string, interface of the called API, e.g. 'INfc', '' if
+                   absent.
+    """
+
+    def __init__(self, text, timestamp=None, event=None, name=None):
+        self.text = text
+        if timestamp is None:
+            match = TIMESTAMP_RE.search(text)
+            timestamp = int(match.group(1)) if match else 0
+        if event is None:
+            match = EVENT_RE.search(text)
+            event = match.group(1) if match else ''
+        if name is None:
+            match = FUNC_NAME_RE.search(text)
+            name = match.group(1) if match else ''
+        # Only the interface of the record, not of the arguments of the call.
+        match = FUNC_MSG_RE.search(text)
+        end = match.start() if match else len(text)
+        match = INTERFACE_RE.search(text, 0, end)
+        self.timestamp = timestamp
+        self.event = event
+        self.name = name
+        self.interface = match.group(1) if match else ''
+
+
+def ParseTextTrace(content):
+    """Splits a text trace into its records.
+
+    Args:
+        content: string, content of a .vts.trace file.
+
+    Returns:
+        a pair of the text before the first record and the list of Record
+        objects.
+    """
+    records = []
+    preamble_end = None
+    index = 0
+    while True:
+        match = RECORDS_RE.search(content, index)
+        if not match:
+            break
+        if preamble_end is None:
+            preamble_end = match.start()
+        end = _FindBlockEnd(content, match.end())
+        records.append(Record(content[match.start():end]))
+        index = end
+    if preamble_end is None:
+        preamble_end = len(content)
+    return content[:preamble_end], records
+
+
+def _FindBlockEnd(content, index):
+    """Returns the index after the brace closing the block opened before."""
+    depth = 1
+    in_string = False
+    while index < len(content):
+        char = content[index]
+        if in_string:
+            if char == '\\':
+                index += 1
+            elif char == '"':
+                in_string = False
+        elif char == '"':
+            in_string = True
+        elif char == '{':
+            depth += 1
+        elif char == '}':
+            depth -= 1
+            if depth == 0:
+                return index + 1
+        index += 1
+    raise ValueError('Unterminated record in trace')
+
+
+def ReadTrace(path):
+    """Returns the Record objects of a text or binary trace file."""
+    with open(path, 'rb') as trace_file:
+        if trace_file.read(len(MAGIC)) == MAGIC:
+            trace_file.seek(0)
+            return list(StreamReader(trace_file).Records())
+        trace_file.seek(0)
+        return ParseTextTrace(trace_file.read())[1]
+
+
+def CallLatencies(records, kinds=LATENCY_EVENT_KINDS):
+    """Pairs the entry and exit records of the calls in a trace.
+
+    An exit record closes the earliest open entry of the same interface, API
+    and event kind, e.g. SERVER_API_EXIT closes SERVER_API_ENTRY.
+
+    Args:
+        records: list of Record objects, in trace order.
+        kinds: tuple of strings, event kinds of the calls to pair, e.g.
+               'SERVER_API'.
+
+    Returns:
+        list of ((interface, API name, event kind), latency in nanoseconds)
+        tuples, in the order the calls started.
+    """
+    open_calls = {}
+    calls = []
+    for record in records:
+        if not record.name or '_' not in record.event:
+            continue
+        kind, _, edge = record.event.rpartition('_')
+        if kind not in kinds:
+            continue
+        key = (record.interface, record.name, kind)
+        if edge == 'ENTRY':
+            open_calls.setdefault(key, []).append(len(calls))
+            calls.append([key, record.timestamp, None])
+        elif edge == 'EXIT':
+            pending = open_calls.get(key)
+            if pending:
+                calls[pending.pop(0)][2] = record.timestamp
+    return [(key, end - start) for key, start, end in calls
+            if end is not None]
+
+
+def ApiName(key):
+    """Formats an (interface, API name, event kind) key of CallLatencies()."""
+    interface, name, kind = key
+    if interface:
+        name = '%s::%s' % (interface, name)
+    return '%s (%s)' % (name, kind)
+
+
+def FormatTextTrace(preamble, records):
+    """Joins records back into the content of a .vts.trace file."""
+    return preamble + '\n'.join(record.text for record in records) + '\n'
+
+
+def _ReadExactly(stream, size):
+    """Reads size bytes, None at the end of the stream."""
+    data = stream.read(size)
+    if not data:
+        return None
+    while len(data) < size:
+        more = stream.read(size - len(data))
+        if not more:
+            raise ValueError('Truncated binary trace')
+        data += more
+    return data
+
+
+def WriteBinaryTrace(stream, preamble, records,
+                     block_records=DEFAULT_BLOCK_RECORDS):
+    """Writes records in the binary format.
+
+    Args:
+        stream: file object opened for binary writing.
+        preamble: string, text before the first record.
+        records: list of Record objects.
+        block_records: int, number of records per block.
+    """
+    offset = 0
+
+    def Write(data):
+        stream.write(data)
+        return len(data)
+
+    offset += Write(MAGIC + struct.pack(HEADER_FORMAT, VERSION))
+    offset += Write(struct.pack('<I', len(preamble)) + preamble)
+
+    names = []
+    name_ids = {}
+    blocks = []
+    for first in range(0, len(records), block_records):
+        block = records[first:first + block_records]
+        payload = zlib.compress(''.join(
+            struct.pack('<I', len(record.text)) + record.text
+            for record in block))
+        blocks.append((offset, first))
+        offset += Write(
+            struct.pack(BLOCK_HEADER_FORMAT, len(payload), len(block),
+                        block[0].timestamp) + payload)
+        for record in block:
+            for name in (record.event, record.name):
+                if name not in name_ids:
+                    name_ids[name] = len(names)
+                    names.append(name)
+
+    index_offset = offset
+    Write(BLOCK_INDEX_MAGIC + struct.pack('<I', len(blocks)))
+    for block_offset, first in blocks:
+        Write(struct.pack(BLOCK_INDEX_FORMAT, block_offset, first))
+    Write(struct.pack('<I', len(records)))
+    for record in records:
+        Write(
+            struct.pack(RECORD_INDEX_FORMAT, record.timestamp,
+                        name_ids[record.event], name_ids[record.name]))
+    Write(struct.pack('<I', len(names)))
+    for name in names:
+        Write(struct.pack('<H', len(name)) + name)
+    Write(struct.pack(TRAILER_FORMAT, index_offset) + TRAILER_MAGIC)
+
+
+def _ReadHeader(stream):
+    """Reads the header of a binary trace, returns its preamble."""
+    header = _ReadExactly(stream, len(MAGIC) + struct.calcsize(HEADER_FORMAT))
+    if not header or header[:len(MAGIC)] != MAGIC:
+        raise ValueError('Not a binary trace')
+    version, = struct.unpack(HEADER_FORMAT, header[len(MAGIC):])
+    if version != VERSION:
+        raise ValueError('Unsupported binary trace version %d' % version)
+    size, = struct.unpack('<I', _ReadExactly(stream, 4))
+    return _ReadExactly(stream, size) if size else ''
+
+
+def _DecodeBlock(payload):
+    """Returns the Record objects of a compressed block."""
+    data = zlib.decompress(payload)
+    records = []
+    index = 0
+    while index < len(data):
+        size, = struct.unpack_from('<I', data, index)
+        index += 4
+        records.append(Record(data[index:index + size]))
+        index += size
+    return records
+
+
+class StreamReader(object):
+    """Decodes a binary trace block by block, in order.
+
+    Attributes:
+        stream: file object the trace is read from.
+        preamble: string, text before the first record.
+    """
+
+    def __init__(self, stream):
+        self._stream = stream
+        self.preamble = _ReadHeader(stream)
+
+    def Blocks(self):
+        """Yields the lists of Record objects of the blocks as they arrive.
+
+        Stops at the index, which streaming consumers do not need.
+        """
+        header_size = struct.calcsize(BLOCK_HEADER_FORMAT)
+        while True:
+            header = _ReadExactly(self._stream, header_size)
+            if not header or header.startswith(BLOCK_INDEX_MAGIC):
+                return
+            size, _, _ = struct.unpack(BLOCK_HEADER_FORMAT, header)
+            yield _DecodeBlock(_ReadExactly(self._stream, size))
+
+    def Records(self):
+        """Yields the Record objects in order."""
+        for block in self.Blocks():
+            for record in block:
+                yield record
+
+
+class IndexedReader(object):
+    """Random access to a binary trace file through its index.
+
+    Attributes:
+        preamble: string, text before the first record.
+        record_count: int, number of records.
+    """
+
+    def __init__(self, path):
+        self._file = open(path, 'rb')
+        self.preamble = _ReadHeader(self._file)
+        trailer_size = struct.calcsize(TRAILER_FORMAT) + len(TRAILER_MAGIC)
+        self._file.seek(-trailer_size, 2)
+        trailer = self._file.read(trailer_size)
+        if trailer[-len(TRAILER_MAGIC):] != TRAILER_MAGIC:
+            raise ValueError('Binary trace has no index')
+        index_offset, = struct.unpack_from(TRAILER_FORMAT, trailer)
+        self._file.seek(index_offset)
+        if self._file.read(len(BLOCK_INDEX_MAGIC)) != BLOCK_INDEX_MAGIC:
+            raise ValueError('Corrupted binary trace index')
+        data = self._file.read()
+
+        block_count, = struct.unpack_from('<I', data)
+        offset = 4
+        self._blocks = []
+        for _ in range(block_count):
+            self._blocks.append(
+                struct.unpack_from(BLOCK_INDEX_FORMAT, data, offset))
+            offset += struct.calcsize(BLOCK_INDEX_FORMAT)
+        self.record_count, = struct.unpack_from('<I', data, offset)
+        offset += 4
+        entries = []
+        for _ in range(self.record_count):
+            entries.append(
+                struct.unpack_from(RECORD_INDEX_FORMAT, data, offset))
+            offset += struct.calcsize(RECORD_INDEX_FORMAT)
+        name_count, = struct.unpack_from('<I', data, offset)
+        offset += 4
+        names = []
+        for _ in range(name_count):
+            size, = struct.unpack_from('<H', data, offset)
+            offset += 2
+            names.append(data[offset:offset + size])
+            offset += size
+        # (timestamp, event, name) of every record.
+        self._entries = [(timestamp, names[event], names[name])
+                         for timestamp, event, name in entries]
+
+    def Close(self):
+        self._file.close()
+
+    def GetEntries(self):
+        """Returns (timestamp, event, API name) of every record, in order."""
+        return list(self._entries)
+
+    def FindCalls(self, name, event=None):
+        """Returns the record numbers of the calls to an API.
+
+        Args:
+            name: string, name of the API.
+            event: string, only the records of this event, e.g.
+                   'SERVER_API_ENTRY', None for all events.
+        """
+        return [
+            number for number, entry in enumerate(self._entries)
+            if entry[2] == name and (event is None or entry[1] == event)
+        ]
+
+    def Records(self, first=0, last=None):
+        """Yields the Record objects numbered first to last, inclusive.
+
+        Only the blocks holding these records are read and decompressed.
+        """
+        if last is None:
+            last = self.record_count - 1
+        header_size = struct.calcsize(BLOCK_HEADER_FORMAT)
+        for index, (block_offset, block_first) in enumerate(self._blocks):
+            block_next = (self._blocks[index + 1][1]
+                          if index + 1 < len(self._blocks) else
+                          self.record_count)
+            if block_next <= first or block_first > last:
+                continue
+            self._file.seek(block_offset)
+            size, _, _ = struct.unpack(BLOCK_HEADER_FORMAT,
+                                       self._file.read(header_size))
+            block = _DecodeBlock(self._file.read(size))
+            for number, record in enumerate(block, block_first):
+                if first <= number <= last:
+                    yield record
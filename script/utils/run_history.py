@@ -0,0 +1,198 @@
+#
+# Copyright 2019 - The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Local database of the run durations of test modules.
+
+Durations are imported from the test_result.xml files written by tradefed
+and used to derive the test-timeout and runtime-hint of the generated
+configures, instead of copying whatever values the configures had before.
+"""
+
+import json
+import math
+import os
+import re
+
+from xml.etree import cElementTree as ET
+
+from utils import gen_manifest
+from utils.percentile import Percentile
+
+# Number of most recent durations kept per module.
+MAX_SAMPLES = 50
+# Number of most recent imported result files remembered.
+MAX_IMPORTED_RESULTS = 1000
+
+DURATION_PATTERN = re.compile(r'^([0-9]+[hms])+$')
+DURATION_PART_PATTERN = re.compile(r'([0-9]+)([hms])')
+DURATION_UNITS = {'h': 3600, 'm': 60, 's': 1}
+
+
+def ParseDuration(text):
+    """Parses a tradefed duration, e.g. '1h30m' or '90s'.
+
+    Args:
+        text: string, the duration.
+
+    Returns:
+        float, the duration in seconds, None if text is not a duration.
+    """
+    if not text or not DURATION_PATTERN.match(text):
+        return None
+    return float(
+        sum(int(value) * DURATION_UNITS[unit]
+            for value, unit in DURATION_PART_PATTERN.findall(text)))
+
+
+def FormatDuration(seconds):
+    """Formats a duration for tradefed, rounded up to whole minutes.
+
+    Args:
+        seconds: float, the duration.
+
+    Returns:
+        string, e.g. '3m', or '2h' for whole hours. At least '1m'.
+    """
+    minutes = max(int(math.ceil(seconds / 60.0)), 1)
+    if minutes % 60 == 0:
+        return '%dh' % (minutes / 60)
+    return '%dm' % minutes
+
+
+def DefaultPath(build_top):
+    """Returns the default location of the run history database."""
+    return gen_manifest.DefaultManifestPath(build_top, 'run_history')
+
+
+class RunHistory(object):
+    """Durations of the past runs of test modules.
+
+    Attributes:
+        path: string, path of the json file that stores the history.
+        durations: dict, maps module names to lists of durations in seconds,
+                   oldest first.
+        imported_results: list of strings, ids of the result files already
+                          imported, oldest first.
+        percentile: int, percentile of the durations the suggested timeouts
+                    are based on.
+        headroom: float, factor applied to the percentile.
+        min_samples: int, minimum number of recorded runs of a module to
+                     suggest values for it.
+    """
+
+    def __init__(self, path, percentile=95, headroom=1.5, min_samples=3):
+        """Loads the history from path if it exists.
+
+        Args:
+            path: string, path of the json file that stores the history.
+            percentile: int, percentile of the durations the suggested
+                        timeouts are based on.
+            headroom: float, factor applied to the percentile.
+            min_samples: int, minimum number of recorded runs of a module.
+        """
+        self._path = path
+        self._durations = {}
+        self._imported_results = []
+        self._percentile = percentile
+        self._headroom = headroom
+        self._min_samples = max(min_samples, 1)
+        if os.path.isfile(path):
+            try:
+                with open(path, 'r') as history_file:
+                    history = json.load(history_file)
+                # Histories without imported results only stored durations.
+                if isinstance(history.get('durations'), dict):
+                    self._durations = history['durations']
+                    self._imported_results = history.get(
+                        'imported_results', [])
+                else:
+                    self._durations = history
+            except ValueError:
+                print 'WARNING: Ignoring corrupted run history %s' % path
+
+    def Add(self, module, seconds):
+        """Records one run of a module."""
+        durations = self._durations.setdefault(module, [])
+        durations.append(seconds)
+        del durations[:-MAX_SAMPLES]
+
+    def AddResultFile(self, path):
+        """Records the completed modules of a tradefed test_result.xml.
+
+        Every module ABI run is one sample, as test-timeout applies to each.
+        A result file is identified by the start time of its invocation, or
+        by its path if it has none, and is only imported once.
+
+        Args:
+            path: string, path of the result file.
+
+        Returns:
+            int, number of samples added, None if the result file was
+            already imported.
+        """
+        root = ET.parse(path).getroot()
+        result_id = root.get('start') or os.path.abspath(path)
+        if result_id in self._imported_results:
+            return None
+        self._imported_results.append(result_id)
+        del self._imported_results[:-MAX_IMPORTED_RESULTS]
+        added = 0
+        for module in root.iter('Module'):
+            if module.get('done') != 'true' or not module.get('runtime'):
+                continue
+            self.Add(module.get('name'), int(module.get('runtime')) / 1000.0)
+            added += 1
+        return added
+
+    def GetDurations(self, module):
+        """Returns the recorded durations of a module in seconds."""
+        return list(self._durations.get(module, []))
+
+    def GetModules(self):
+        """Returns the sorted names of the modules with a history."""
+        return sorted(self._durations)
+
+    def Suggest(self, module):
+        """Derives test-timeout and runtime-hint from the history.
+
+        The runtime hint is the median duration, which is what schedulers
+        bin-pack with. The timeout is the configured percentile of the
+        durations multiplied by the headroom.
+
+        Args:
+            module: string, name of the test module.
+
+        Returns:
+            a pair of strings (test-timeout, runtime-hint), None if the
+            module has fewer than min_samples runs.
+        """
+        durations = self._durations.get(module, [])
+        if len(durations) < self._min_samples:
+            return None
+        return (FormatDuration(
+            Percentile(durations, self._percentile) * self._headroom),
+                FormatDuration(Percentile(durations, 50)))
+
+    def Save(self):
+        """Writes the history back to disk."""
+        dir_path = os.path.dirname(self._path)
+        if dir_path and not os.path.exists(dir_path):
+            os.makedirs(dir_path)
+        history = {
+            'durations': self._durations,
+            'imported_results': self._imported_results,
+        }
+        with open(self._path, 'w') as history_file:
+            json.dump(history, history_file, indent=2, sort_keys=True)
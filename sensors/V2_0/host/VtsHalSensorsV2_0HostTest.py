@@ -16,9 +16,12 @@
 #
 
 import logging
+import time
 
 from vts.runners.host import asserts
 from vts.runners.host import test_runner
+from vts.testcases.hal.script.utils.percentile import Percentile
+from vts.testcases.hal.sensors.V2_0.host import sensors_benchmark
 from vts.testcases.template.hal_hidl_host_test import hal_hidl_host_test
 
 
@@ -30,6 +33,15 @@ class SensorsHidlTest(hal_hidl_host_test.HalHidlHostTest):
     """
 
     TEST_HAL_SERVICES = {"android.hardware.sensors@2.0::ISensors"}
+    # Capacity of the event FMQ in events and of the wake lock FMQ.
+    EVENT_QUEUE_EVENTS = 1024
+    WAKE_LOCK_QUEUE_SIZE = 128
+    # SensorFlagBits.WAKE_UP and SensorFlagBits.MASK_REPORTING_MODE.
+    WAKE_UP_FLAG = 0x1
+    REPORTING_MODE_MASK = 0xe
+    # Nanoseconds a blocking read of the event FMQ waits for new events.
+    EVENT_READ_TIMEOUT_NS = 10 * 1000 * 1000
+
     def setUpClass(self):
         """Creates a mirror and turns on the framework-layer SENSORS service."""
         super(SensorsHidlTest, self).setUpClass()
@@ -69,5 +81,181 @@ class SensorsHidlTest(hal_hidl_host_test.HalHidlHostTest):
         asserts.assertEqual(sensors_types.SensorType.MAGNETIC_FIELD, 2)
         asserts.assertEqual(sensors_types.SensorType.GYROSCOPE, 4)
 
+    def drainEvents(self, duration, until=None):
+        """Reads the event FMQ for a while and acknowledges wake-up events.
+
+        Args:
+            duration: float, maximum number of seconds to read.
+            until: function, returns True to stop reading early.
+        """
+        deadline = time.time() + duration
+        while time.time() < deadline and not (until and until()):
+            # Blocking reads wait on the READ_AND_PROCESS bit of the event
+            # flag and wake EVENTS_READ, which are the FMQ_NOT_EMPTY and
+            # FMQ_NOT_FULL bits of the default blocking FMQ calls.
+            available = self._event_queue.availableToRead()
+            count = (available - available % sensors_benchmark.EVENT_SIZE or
+                     sensors_benchmark.EVENT_SIZE)
+            data = []
+            if not self._event_queue.readBlocking(
+                    data, count, self.EVENT_READ_TIMEOUT_NS):
+                continue
+            mark = self._event_log.Mark()
+            self._event_log.AddBytes(data)
+            wake_ups = self._event_log.CountSensorEvents(
+                self._wake_up_handles, mark)
+            if wake_ups:
+                start = time.time()
+                # Wakes WakeLockQueueFlagBits::DATA_WRITTEN.
+                self._wake_lock_queue.writeBlocking([wake_ups], 1)
+                self._wake_lock_round_trips.append(
+                    (time.time() - start) * 1000)
+
+    def measureSensors(self, sensors, window):
+        """Activates sensors at their max rate and measures their delivery.
+
+        Args:
+            sensors: list of SensorInfo dicts, activated at the same time.
+            window: float, number of seconds to collect events for.
+
+        Returns:
+            dict, maps sensor handle to the stats of SensorsEventLog.Stats(),
+            with the flush completion time in ms added.
+        """
+        for sensor in sensors:
+            self.dut.hal.sensors.batch(sensor["sensorHandle"],
+                                       sensor["minDelay"] * 1000, 0)
+            self.dut.hal.sensors.activate(sensor["sensorHandle"], True)
+        # Skip the first events, which may be reported before the sensors
+        # run at their rate.
+        self.drainEvents(min(1.0, window / 2.0))
+        start = self._event_log.Mark()
+        self.drainEvents(window)
+        end = self._event_log.Mark()
+
+        results = {}
+        for sensor in sensors:
+            handle = sensor["sensorHandle"]
+            stats = self._event_log.Stats(handle, sensor["minDelay"] * 1000,
+                                          start, end)
+            mark = self._event_log.Mark()
+            flush_start = time.time()
+            self.dut.hal.sensors.flush(handle)
+            self.drainEvents(
+                1.0, lambda: self._event_log.FlushCompleteTime(handle, mark))
+            flush_time = self._event_log.FlushCompleteTime(handle, mark)
+            if stats is not None:
+                stats["flush_ms"] = ((flush_time - flush_start) * 1000
+                                     if flush_time else None)
+            results[handle] = stats
+        for sensor in sensors:
+            self.dut.hal.sensors.activate(sensor["sensorHandle"], False)
+        return results
+
+    def testEventQueueBenchmark(self):
+        """Measures the event FMQ path at the max rate of every sensor.
+
+        Runs only if the sensors_benchmark_window_sec user param is larger
+        than 0. The framework is stopped, because the HAL only serves the
+        client that initialized it last.
+
+        Both FMQs are blocking, so that they carry the event flag words the
+        HAL waits on. The VTS resource mirror only creates FMQs of scalar
+        types, and the HAL expects a MessageQueue<Event>, so a HAL that
+        checks the quantum size of the event FMQ rejects it. The benchmark
+        is skipped on such a HAL.
+
+        Every continuous sensor runs alone and then all of them run at once.
+        A sensor delivering less than sensors_rate_tolerance of its rate
+        while all run at once, but not while running alone, is reported as
+        starved.
+        """
+        window = float(self.getUserParam("sensors_benchmark_window_sec",
+                                         default_value=0))
+        asserts.skipIf(window <= 0, "Sensors benchmark is disabled")
+        tolerance = float(self.getUserParam("sensors_rate_tolerance",
+                                            default_value=0.9))
+
+        self.shell.Execute("stop")
+        try:
+            self._event_queue = self.dut.resource.InitFmq(
+                data_type="uint8_t",
+                sync=True,
+                queue_size=self.EVENT_QUEUE_EVENTS *
+                sensors_benchmark.EVENT_SIZE,
+                blocking=True)
+            self._wake_lock_queue = self.dut.resource.InitFmq(
+                data_type="uint32_t",
+                sync=True,
+                queue_size=self.WAKE_LOCK_QUEUE_SIZE,
+                blocking=True)
+            callback = self.dut.hal.sensors.GetHidlCallbackInterface(
+                "ISensorsCallback",
+                onDynamicSensorsConnected=lambda sensorInfos: None,
+                onDynamicSensorsDisconnected=lambda sensorHandles: None)
+            result = self.dut.hal.sensors.initialize(
+                self._event_queue, self._wake_lock_queue, callback)
+            sensors_types = self.dut.hal.sensors.GetHidlTypeInterface(
+                "types")
+            asserts.skipIf(
+                result == sensors_types.Result.BAD_VALUE,
+                "HAL rejected the event FMQ, which is not a "
+                "MessageQueue<Event>: unsupported through the VTS resource "
+                "mirror")
+            asserts.assertEqual(sensors_types.Result.OK, result,
+                                "initialize failed")
+            self._event_log = sensors_benchmark.SensorsEventLog()
+            self._wake_lock_round_trips = []
+
+            sensors = [
+                sensor for sensor in self.dut.hal.sensors.getSensorsList()
+                if sensor["minDelay"] > 0 and
+                sensor["flags"] & self.REPORTING_MODE_MASK == 0
+            ]
+            self._wake_up_handles = set(
+                sensor["sensorHandle"] for sensor in sensors
+                if sensor["flags"] & self.WAKE_UP_FLAG)
+            asserts.skipIf(not sensors, "No continuous sensor")
+
+            alone = {}
+            for sensor in sensors:
+                alone.update(self.measureSensors([sensor], window))
+            together = self.measureSensors(sensors, window)
+        finally:
+            self.shell.Execute("start")
+
+        starved = []
+        for sensor in sensors:
+            handle = sensor["sensorHandle"]
+            for mode, stats in (("alone", alone[handle]),
+                                ("all", together[handle])):
+                logging.info("Sensor %s (%d) %s: %s", sensor["name"], handle,
+                             mode, stats)
+            if (alone[handle] and alone[handle]["rate_hz"] >=
+                    tolerance * alone[handle]["requested_hz"] and
+                (not together[handle] or together[handle]["rate_hz"] <
+                 tolerance * together[handle]["requested_hz"])):
+                starved.append(sensor["name"])
+        if self._wake_lock_round_trips:
+            logging.info(
+                "Wake lock FMQ writes: %d, p50 %.2f ms, p99 %.2f ms",
+                len(self._wake_lock_round_trips),
+                Percentile(self._wake_lock_round_trips, 50),
+                Percentile(self._wake_lock_round_trips, 99))
+
+        if self.web.enabled:
+            measured = [sensor for sensor in sensors
+                        if together[sensor["sensorHandle"]]]
+            labels = [sensor["name"] for sensor in measured]
+            for name in ("rate_hz", "latency_p99_ms"):
+                self.web.AddProfilingDataLabeledVector(
+                    "sensors_all_%s" % name, labels,
+                    [int(together[sensor["sensorHandle"]][name])
+                     for sensor in measured],
+                    x_axis_label="sensor",
+                    y_axis_label=name)
+        asserts.assertEqual([], starved,
+                            "Sensors starved when all sensors are active")
+
 if __name__ == "__main__":
     test_runner.main()
@@ -0,0 +1,139 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2019 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Event throughput and latency of the sensors@2.0 Event FMQ.
+
+The sensors@2.0 HAL writes sensors@1.0::Event structs into the event FMQ
+passed to ISensors::initialize. SensorsEventLog drains the raw bytes of the
+queue, decodes the events, and stamps them with the host time at which they
+were read.
+
+The device clock of the event timestamps is not synchronized with the host,
+so the delivery latency is reported relative to the fastest delivered event
+of a sensor. This excess latency grows with queueing and starvation in the
+HAL, which is what the benchmark is after.
+"""
+
+import struct
+import time
+
+from vts.testcases.hal.script.utils.percentile import Percentile
+
+# sizeof(android::hardware::sensors::V1_0::Event): int64 timestamp,
+# int32 sensorHandle, int32 sensorType and a 64 byte EventPayload union.
+EVENT_FORMAT = "<qii64s"
+EVENT_SIZE = struct.calcsize(EVENT_FORMAT)
+# SensorType::META_DATA and MetaDataEventType::META_DATA_FLUSH_COMPLETE.
+META_DATA_SENSOR_TYPE = 0
+META_DATA_FLUSH_COMPLETE = 1
+
+
+class SensorsEventLog(object):
+    """Decoded events of the event FMQ with their host read time.
+
+    Attributes:
+        _events: list of (host time, timestamp ns, sensor handle, sensor
+                 type, payload bytes) tuples.
+        _pending: string, bytes of an incomplete event from the last read.
+    """
+
+    def __init__(self):
+        self._events = []
+        self._pending = ""
+
+    def AddBytes(self, data, read_time=None):
+        """Decodes raw queue content read at read_time.
+
+        Args:
+            data: string or list of ints, bytes read from the event FMQ.
+            read_time: float, host time of the read, now if None.
+        """
+        if read_time is None:
+            read_time = time.time()
+        if isinstance(data, list):
+            data = "".join(chr(byte & 0xff) for byte in data)
+        data = self._pending + data
+        complete = len(data) - len(data) % EVENT_SIZE
+        for offset in range(0, complete, EVENT_SIZE):
+            timestamp, handle, sensor_type, payload = struct.unpack_from(
+                EVENT_FORMAT, data, offset)
+            self._events.append((read_time, timestamp, handle, sensor_type,
+                                 payload))
+        self._pending = data[complete:]
+
+    def Mark(self):
+        """Returns a position so that later queries only see newer events."""
+        return len(self._events)
+
+    def CountSensorEvents(self, handles, mark=0):
+        """Returns the number of sensor events of a set of handles after a mark."""
+        return sum(1 for event in self._events[mark:]
+                   if event[2] in handles and
+                   event[3] != META_DATA_SENSOR_TYPE)
+
+    def FlushCompleteTime(self, handle, mark=0):
+        """Returns the host time of the flush complete event of a sensor.
+
+        Args:
+            handle: int, the sensor handle that was flushed.
+            mark: int, position returned by Mark() before the flush.
+
+        Returns:
+            float, host time, None if the flush did not complete.
+        """
+        for read_time, _, event_handle, sensor_type, payload in \
+                self._events[mark:]:
+            if (sensor_type == META_DATA_SENSOR_TYPE and
+                    event_handle == handle and
+                    struct.unpack_from("<I", payload)[0] ==
+                    META_DATA_FLUSH_COMPLETE):
+                return read_time
+        return None
+
+    def Stats(self, handle, period_ns, start=0, end=None):
+        """Computes the delivery of a sensor between two marks.
+
+        Args:
+            handle: int, the sensor handle.
+            period_ns: int, the requested sampling period.
+            start: int, position returned by Mark() at the window start.
+            end: int, position returned by Mark() at the window end.
+
+        Returns:
+            dict with the number of events, the rate in Hz spanned by their
+            timestamps, the requested rate, and the p50 and p99 delivery
+            latency in ms above the fastest delivered event. None if fewer
+            than two events were delivered.
+        """
+        events = [(read_time, timestamp)
+                  for read_time, timestamp, event_handle, sensor_type, _ in
+                  self._events[start:end]
+                  if event_handle == handle and
+                  sensor_type != META_DATA_SENSOR_TYPE]
+        if len(events) < 2:
+            return None
+        span_ns = events[-1][1] - events[0][1]
+        offsets = [read_time * 1e3 - timestamp / 1e6
+                   for read_time, timestamp in events]
+        best = min(offsets)
+        latencies = [offset - best for offset in offsets]
+        return {
+            "events": len(events),
+            "rate_hz": (len(events) - 1) * 1e9 / span_ns if span_ns else 0,
+            "requested_hz": 1e9 / period_ns,
+            "latency_p50_ms": Percentile(latencies, 50),
+            "latency_p99_ms": Percentile(latencies, 99),
+        }
@@ -19,8 +19,8 @@ import logging
 
 from vts.runners.host import asserts
 from vts.runners.host import base_test
-from vts.runners.host import const
 from vts.runners.host import test_runner
+from vts.testcases.hal import device_snapshot
 from vts.utils.python.android import api
 
 
@@ -30,38 +30,34 @@ class VtsTreblePlatformVersionTest(base_test.BaseTestClass):
     def setUpClass(self):
         self.dut = self.android_devices[0]
         self.dut.shell.InvokeTerminal("VtsTreblePlatformVersionTest")
+        self.snapshot = device_snapshot.GetSnapshot(self.dut)
 
     def getProp(self, prop, required=True):
-        """Helper to retrieve a property from device."""
+        """Helper to retrieve a property from the device snapshot."""
 
-        results = self.dut.shell.Execute("getprop " + prop)
+        result = self.snapshot.GetProperty(prop)
         if required:
-            asserts.assertEqual(results[const.EXIT_CODE][0], 0,
-                "getprop must succeed")
-            asserts.assertTrue(len(results[const.STDOUT][0].strip()) > 0,
+            asserts.assertTrue(result is not None,
                 "getprop must return a value")
-        else:
-            if (results[const.EXIT_CODE][0] != 0 or
-                len(results[const.STDOUT][0].strip()) == 0):
-                logging.info("sysprop %s undefined", prop)
-                return None
+        elif result is None:
+            logging.info("sysprop %s undefined", prop)
+            return None
 
-        result = results[const.STDOUT][0].strip()
+        result = result.strip()
 
         logging.info("getprop {}={}".format(prop, result))
 
         return result
 
     def getEnv(self, env):
-        """Helper to retrieve an environment varable from device."""
+        """Helper to retrieve an environment varable from the device snapshot."""
 
-        results = self.dut.shell.Execute("printenv " + env)
-        if (results[const.EXIT_CODE][0] != 0 or
-            len(results[const.STDOUT][0].strip()) == 0):
+        result = self.snapshot.GetEnv(env)
+        if result is None or len(result.strip()) == 0:
             logging.info("environment variable %s undefined", env)
             return None
 
-        result = results[const.STDOUT][0].strip()
+        result = result.strip()
 
         logging.info("printenv {}:{}".format(env, result))
 
@@ -23,6 +23,7 @@ from vts.runners.host import asserts
 from vts.runners.host import base_test
 from vts.runners.host import const
 from vts.runners.host import test_runner
+from vts.testcases.hal import device_snapshot
 from vts.testcases.template.hal_hidl_host_test import hal_hidl_host_test
 from vts.utils.python.controllers import adb
 
@@ -45,7 +46,8 @@ class UsbGadgetHidlTest(hal_hidl_host_test.HalHidlHostTest):
             self.adb.wait_for_device()
         except adb.AdbError as e:
             logging.exception(e)
-        self.serialno = self.adb.shell("getprop ro.serialno")
+        self.serialno = device_snapshot.GetSnapshot(self.dut).GetProperty(
+            "ro.serialno")
 
     def checkProtocol(self, usb_class, usb_sub_class, usb_protocol):
         """Queries the host USB bus to see if the interface is present.
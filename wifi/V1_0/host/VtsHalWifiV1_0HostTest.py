@@ -17,8 +17,9 @@
 
 import logging
 
-from vts.runners.host import const
 from vts.runners.host import test_runner
+from vts.testcases.hal import device_snapshot
+from vts.testcases.hal import framework_window
 from vts.testcases.template.hal_hidl_gtest import hal_hidl_gtest
 
 
@@ -29,24 +30,23 @@ class VtsHalWifiV1_0Host(hal_hidl_gtest.HidlHalGTest):
     WIFI_SOFTAP_FEATURE_NAME = "android.hardware.wifi.hostapd"
 
     def setUpClass(self):
-        """Disable android framework."""
+        """Disable android framework, unless a plan window stopped it."""
         super(VtsHalWifiV1_0Host, self).setUpClass()
         self.dut = self.android_devices[0]
         self.shell = self.dut.shell
-        self.dut.stop(True)
+        self._framework_stopped = framework_window.StopFramework(self.dut)
 
     def tearDownClass(self):
-        """Enable android framework."""
-        self.dut.start()
+        """Enable android framework if setUpClass disabled it."""
+        framework_window.StartFramework(self.dut, self._framework_stopped)
         super(VtsHalWifiV1_0Host, self).tearDownClass()
 
     def CreateTestCases(self):
         """Get all registered test components and create test case objects."""
-        pm_list = self.shell.Execute("pm list features")
-        self._nan_on = self.WIFI_AWARE_FEATURE_NAME in pm_list[const.STDOUT][0]
+        snapshot = device_snapshot.GetSnapshot(self._dut)
+        self._nan_on = snapshot.HasFeature(self.WIFI_AWARE_FEATURE_NAME)
         logging.info("Wifi NaN Feature Supported: %s", self._nan_on)
-        vintf_list = self.shell.Execute("grep android\\.hardware\\.wifi\\.hostapd /vendor/etc/vintf/manifest.xml")
-        self._softap_on = self.WIFI_SOFTAP_FEATURE_NAME in vintf_list[const.STDOUT][0]
+        self._softap_on = self.WIFI_SOFTAP_FEATURE_NAME in snapshot.vintf_manifest
         logging.info("Wifi SoftAP Feature Supported: %s", self._softap_on)
         super(VtsHalWifiV1_0Host, self).CreateTestCases()
 
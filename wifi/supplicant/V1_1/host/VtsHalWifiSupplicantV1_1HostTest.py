@@ -17,8 +17,9 @@
 
 import logging
 
-from vts.runners.host import const
 from vts.runners.host import test_runner
+from vts.testcases.hal import device_snapshot
+from vts.testcases.hal import framework_window
 from vts.testcases.template.hal_hidl_gtest import hal_hidl_gtest
 
 
@@ -28,21 +29,21 @@ class VtsHalWifiSupplicantV1_1Host(hal_hidl_gtest.HidlHalGTest):
     WIFI_DIRECT_FEATURE_NAME = "android.hardware.wifi.direct"
 
     def setUpClass(self):
-        """Disable android framework."""
+        """Disable android framework, unless a plan window stopped it."""
         super(VtsHalWifiSupplicantV1_1Host, self).setUpClass()
         self.dut = self.android_devices[0]
         self.shell = self.dut.shell
-        self.dut.stop(True)
+        self._framework_stopped = framework_window.StopFramework(self.dut)
 
     def tearDownClass(self):
-        """Enable android framework."""
-        self.dut.start()
+        """Enable android framework if setUpClass disabled it."""
+        framework_window.StartFramework(self.dut, self._framework_stopped)
         super(VtsHalWifiSupplicantV1_1Host, self).tearDownClass()
 
     def CreateTestCases(self):
         """Get all registered test components and create test case objects."""
-        pm_list = self.shell.Execute("pm list features")
-        self._p2p_on = self.WIFI_DIRECT_FEATURE_NAME in pm_list[const.STDOUT][0]
+        snapshot = device_snapshot.GetSnapshot(self._dut)
+        self._p2p_on = snapshot.HasFeature(self.WIFI_DIRECT_FEATURE_NAME)
         logging.info("Wifi P2P Feature Supported: %s", self._p2p_on)
         super(VtsHalWifiSupplicantV1_1Host, self).CreateTestCases()
 
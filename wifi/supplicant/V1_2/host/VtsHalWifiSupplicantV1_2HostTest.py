@@ -17,8 +17,8 @@
 
 import logging
 
-from vts.runners.host import const
 from vts.runners.host import test_runner
+from vts.testcases.hal import device_snapshot
 from vts.testcases.template.hal_hidl_gtest import hal_hidl_gtest
 
 
@@ -29,8 +29,8 @@ class VtsHalWifiSupplicantV1_2Host(hal_hidl_gtest.HidlHalGTest):
 
     def CreateTestCases(self):
         """Get all registered test components and create test case objects."""
-        pm_list = self.shell.Execute("pm list features")
-        self._p2p_on = self.WIFI_DIRECT_FEATURE_NAME in pm_list[const.STDOUT][0]
+        snapshot = device_snapshot.GetSnapshot(self._dut)
+        self._p2p_on = snapshot.HasFeature(self.WIFI_DIRECT_FEATURE_NAME)
         logging.info("Wifi P2P Feature Supported: %s", self._p2p_on)
         super(VtsHalWifiSupplicantV1_2Host, self).CreateTestCases()
 